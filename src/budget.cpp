@@ -0,0 +1,64 @@
+#include "budget.h"
+#include <algorithm>
+
+TimeBudget::TimeBudget(const std::vector<Duration>& allocations, unsigned int runsPerInstance)
+    : instanceCount{allocations.size()}, runsPerInstance{runsPerInstance}, accounts{std::make_unique<Account[]>(allocations.size())} {
+    for (std::size_t i{0}; i < instanceCount; ++i)
+        accounts[i].allocation.store(allocations[i].count(), std::memory_order_relaxed);
+}
+
+void TimeBudget::release(std::size_t instance, Duration unused, bool bConverged) {
+    std::lock_guard lock{m};
+    auto& account = accounts[instance];
+    ++account.finishedRuns;
+    account.bConverged = bConverged;
+    if (unused <= Duration::zero())
+        return;
+
+    // Share in proportion to the time the receivers already have left, and
+    // twice as much to those that were still improving when their last run ended.
+    const auto weight = [&](const Account& a) {
+        const auto runsLeft = runsPerInstance - a.finishedRuns;
+        return static_cast<double>(a.allocation.load(std::memory_order_relaxed)) * runsLeft * (a.bConverged ? 1.0 : 2.0);
+    };
+    double sum{0.0};
+    for (std::size_t i{0}; i < instanceCount; ++i)
+        sum += weight(accounts[i]);
+    if (sum <= 0.0)
+        return;
+
+    for (std::size_t i{0}; i < instanceCount; ++i) {
+        auto& a = accounts[i];
+        const auto w = weight(a);
+        if (w <= 0.0)
+            continue;
+        // Spread over the runs left, including the ones already running
+        const auto share = static_cast<Duration::rep>(unused.count() * (w / sum) / (runsPerInstance - a.finishedRuns));
+        a.allocation.fetch_add(share, std::memory_order_relaxed);
+    }
+}
+
+TimeBudget::Run::Run(TimeBudget& budget, std::size_t instance)
+    : budget{budget}, instance{instance}, start{Clock::now()}, lastImprovement{start} {
+}
+
+TimeBudget::Run::~Run() {
+    const auto now = Clock::now();
+    const auto unused = budget.allocation(instance) - std::chrono::duration_cast<Duration>(now - start);
+    budget.release(instance, std::max(unused, Duration::zero()), stalled(now));
+}
+
+void TimeBudget::Run::resume(Duration elapsed, Duration improvedAt) {
+    start = Clock::now() - elapsed;
+    lastImprovement = start + improvedAt;
+}
+
+bool TimeBudget::Run::stalled(Clock::time_point now) const {
+    // Converged once it has searched as long without improving as it took to get there
+    return std::max<Clock::duration>(lastImprovement - start, MIN_STALL) <= now - lastImprovement;
+}
+
+bool TimeBudget::Run::expired() const {
+    const auto now = Clock::now();
+    return stalled(now) || budget.allocation(instance) <= now - start;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Shares the total running time between instances based on how they converge
+ * Every instance starts out with a fixed time for each of its runs. A run that
+ * has gone without improving for as long as it took to find its best solution
+ * (and at least MIN_STALL) is considered converged and stops early. The time it
+ * didn't use is handed over to the instances that still have runs left,
+ * favouring the ones whose last run was still improving when its time ran out.
+ * Works the same whether runs execute one after another or concurrently, as
+ * time is only handed over when a run finishes.
+ */
+class TimeBudget {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Duration = std::chrono::microseconds;
+
+    /// Time without improvement before a run is considered converged, at the least
+    static constexpr Duration MIN_STALL = std::chrono::seconds{1};
+
+    /**
+     * @param allocations Initial time of every run of each instance
+     * @param runsPerInstance How many runs each instance is searched with
+     */
+    TimeBudget(const std::vector<Duration>& allocations, unsigned int runsPerInstance);
+
+    TimeBudget(const TimeBudget&) = delete;
+    TimeBudget& operator=(const TimeBudget&) = delete;
+
+    /// Time of every run of instance. Grows as other instances hand over time.
+    Duration allocation(std::size_t instance) const { return Duration{accounts[instance].allocation.load(std::memory_order_relaxed)}; }
+
+    /**
+     * @brief A single run's view of the budget
+     * Starts counting when constructed, and hands over any unused time when destroyed.
+     */
+    class Run {
+    public:
+        Run(TimeBudget& budget, std::size_t instance);
+        ~Run();
+
+        Run(const Run&) = delete;
+        Run& operator=(const Run&) = delete;
+
+        /// Whether the run should stop, either because its time is up or because it has converged
+        bool expired() const;
+        /// Whether the run has gone long enough without improving to be considered converged
+        bool converged() const { return stalled(Clock::now()); }
+        /// Reports that the run found a new best solution
+        void improved() { lastImprovement = Clock::now(); }
+
+        /// Time the run has used so far
+        Duration elapsed() const { return std::chrono::duration_cast<Duration>(Clock::now() - start); }
+        /// When the run last found a new best solution, counted from its start
+        Duration improvedAt() const { return std::chrono::duration_cast<Duration>(lastImprovement - start); }
+        /// Continues a run that had already used elapsed time, as when resuming from a checkpoint
+        void resume(Duration elapsed, Duration improvedAt);
+
+    private:
+        bool stalled(Clock::time_point now) const;
+
+        TimeBudget& budget;
+        std::size_t instance;
+        Clock::time_point start;
+        Clock::time_point lastImprovement;
+    };
+
+private:
+    struct Account {
+        std::atomic<Duration::rep> allocation{0};
+        // Guarded by mutex:
+        unsigned int finishedRuns{0};
+        bool bConverged{false};     // Whether the last finished run converged before its time was up
+    };
+
+    /// Distributes time unused by a run of instance among the instances that have runs left
+    void release(std::size_t instance, Duration unused, bool bConverged);
+
+    std::size_t instanceCount;
+    unsigned int runsPerInstance;
+    std::unique_ptr<Account[]> accounts;
+    std::mutex m;
+};
@@ -0,0 +1,200 @@
+#include "checkpoint.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+
+namespace {
+constexpr char MAGIC[8] = {'P', 'D', 'P', 'S', 'T', 'A', 'T', 'E'};
+constexpr uint32_t VERSION = 3;
+
+template <typename T>
+void put(std::ostream& os, const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool get(std::istream& is, T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    is.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(is);
+}
+
+// Length prefixed range of trivially copyable values
+template <typename T>
+void putRange(std::ostream& os, const T* data, std::size_t count) {
+    put(os, static_cast<uint32_t>(count));
+    os.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+template <typename T>
+bool getRange(std::istream& is, std::vector<T>& out, std::size_t maxCount) {
+    uint32_t count;
+    if (!get(is, count) || maxCount < count)
+        return false;
+    out.resize(count);
+    is.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    return static_cast<bool>(is);
+}
+
+// Engines only expose their state through streams
+void putEngine(std::ostream& os, const Random& engine) {
+    std::ostringstream ss;
+    ss << engine;
+    const auto str = ss.str();
+    putRange(os, str.data(), str.size());
+}
+
+bool getEngine(std::istream& is, Random& engine) {
+    std::vector<char> str;
+    if (!getRange(is, str, 1 << 16))
+        return false;
+    std::istringstream ss{std::string{str.begin(), str.end()}};
+    ss >> engine;
+    return !ss.fail();
+}
+
+void putSolution(std::ostream& os, const SolutionCached& s, int cost) {
+    put(os, static_cast<int32_t>(cost));
+    put(os, static_cast<uint32_t>(s.size()));
+    for (const auto& route : s)
+        putRange(os, route.calls.data(), route.calls.size());
+    const auto order = s.index.order();
+    putRange(os, order.data(), order.size());
+}
+
+bool getSolution(std::istream& is, const Problem& p, SolutionCached& s, int& cost) {
+    int32_t c;
+    uint32_t routeCount;
+    if (!get(is, c) || !get(is, routeCount) || routeCount != p.vehicles.size() + 1)
+        return false;
+    cost = c;
+
+    const auto n = p.calls.size();
+    s.assign(routeCount, VehicleSolution{});
+    std::vector<index_t> calls;
+    std::vector<uint8_t> stops(n, 0);
+    for (auto& route : s) {
+        if (!getRange(is, calls, 2 * n))
+            return false;
+        for (const auto call : calls)
+            if (n <= call || 2 < ++stops[call])
+                return false;
+        route.calls = Route{calls.begin(), calls.end()};
+        route.bChanged = true;
+    }
+    if (std::any_of(stops.begin(), stops.end(), [](const auto count){ return count != 2; }))
+        return false;
+
+    std::vector<index_t> order;
+    if (!getRange(is, order, n))
+        return false;
+    if (!order.empty()) {
+        if (order.size() != n)
+            return false;
+        std::vector<bool> seen(n, false);
+        for (const auto call : order) {
+            if (n <= call || seen[call])
+                return false;
+            seen[call] = true;
+        }
+        s.index.build(s, order);
+        if (!s.index.consistent(s))
+            return false;
+    }
+    return true;
+}
+}
+
+std::optional<std::runtime_error> saveSearchState(const std::filesystem::path& path, const SearchState& state) {
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream os{tmp, std::ofstream::binary | std::ofstream::trunc};
+        if (!os)
+            return std::runtime_error{"Failed to open checkpoint file " + tmp.string()};
+
+        os.write(MAGIC, sizeof(MAGIC));
+        put(os, VERSION);
+        // Vehicle and call counts, to recognize states of other problems
+        std::size_t stops{0};
+        for (const auto& route : state.best)
+            stops += route.calls.size();
+        put(os, static_cast<uint32_t>(state.best.size() - 1));
+        put(os, static_cast<uint32_t>(stops / 2));
+
+        put(os, static_cast<uint8_t>(state.bFinished));
+        put(os, static_cast<uint32_t>(state.iteration));
+        put(os, static_cast<uint32_t>(state.iterationsSinceNewBest));
+        put(os, static_cast<uint32_t>(state.iterationsSinceMigration));
+        put(os, static_cast<uint32_t>(state.iterationsSinceImprovement));
+        put(os, static_cast<uint8_t>(state.bNewBestSinceMigration));
+        put(os, state.temperature);
+        put(os, static_cast<int64_t>(state.elapsed.count()));
+        put(os, static_cast<int64_t>(state.improvedAt.count()));
+        put(os, static_cast<int64_t>(state.sinceImprovement.count()));
+        putRange(os, state.weights.data(), state.weights.size());
+
+        putEngine(os, state.ran);
+        put(os, static_cast<uint32_t>(state.streams.size()));
+        for (const auto& stream : state.streams)
+            putEngine(os, stream);
+
+        putSolution(os, state.best, state.bestCost);
+        putSolution(os, state.localBest, state.localBestCost);
+
+        if (!os.flush())
+            return std::runtime_error{"Failed to write checkpoint file " + tmp.string()};
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec)
+        return std::runtime_error{"Failed to replace checkpoint file " + path.string() + ": " + ec.message()};
+    return std::nullopt;
+}
+
+Result<SearchState, std::runtime_error> loadSearchState(const std::filesystem::path& path, const Problem& p) {
+    std::ifstream is{path, std::ifstream::binary};
+    if (!is)
+        return std::runtime_error{"Failed to open checkpoint file " + path.string()};
+    const auto corrupt = [&](){ return std::runtime_error{"Checkpoint file " + path.string() + " is corrupt or from another problem"}; };
+
+    char magic[sizeof(MAGIC)];
+    uint32_t version, vehicleCount, callCount;
+    is.read(magic, sizeof(magic));
+    if (!is || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !get(is, version) || version != VERSION)
+        return std::runtime_error{"File " + path.string() + " is not a checkpoint of this version"};
+    if (!get(is, vehicleCount) || !get(is, callCount) || vehicleCount != p.vehicles.size() || callCount != p.calls.size())
+        return corrupt();
+
+    SearchState state;
+    uint8_t bFinished, bNewBestSinceMigration;
+    uint32_t iteration, iterationsSinceNewBest, iterationsSinceMigration, iterationsSinceImprovement, streamCount;
+    int64_t elapsed, improvedAt, sinceImprovement;
+    if (!get(is, bFinished) || !get(is, iteration) || !get(is, iterationsSinceNewBest) || !get(is, iterationsSinceMigration) || !get(is, iterationsSinceImprovement)
+        || !get(is, bNewBestSinceMigration) || !get(is, state.temperature) || !get(is, elapsed) || !get(is, improvedAt) || !get(is, sinceImprovement)
+        || !getRange(is, state.weights, 1 << 10) || !getEngine(is, state.ran) || !get(is, streamCount) || (1 << 16) < streamCount)
+        return corrupt();
+    state.bFinished = bFinished != 0;
+    state.iteration = iteration;
+    state.iterationsSinceNewBest = iterationsSinceNewBest;
+    state.iterationsSinceMigration = iterationsSinceMigration;
+    state.iterationsSinceImprovement = iterationsSinceImprovement;
+    state.bNewBestSinceMigration = bNewBestSinceMigration != 0;
+    state.elapsed = std::chrono::microseconds{elapsed};
+    state.improvedAt = std::chrono::microseconds{improvedAt};
+    state.sinceImprovement = std::chrono::microseconds{sinceImprovement};
+
+    state.streams.resize(streamCount);
+    for (auto& stream : state.streams)
+        if (!getEngine(is, stream))
+            return corrupt();
+
+    if (!getSolution(is, p, state.best, state.bestCost) || !getSolution(is, p, state.localBest, state.localBestCost))
+        return corrupt();
+    return state;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "problem.h"
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include "random.h"
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Everything adaptiveCachedSearch needs to continue from the end of a segment
+ * Scores are reset at the end of every segment, so they don't need saving.
+ */
+struct SearchState {
+    bool bFinished{false};                      // Whether the search had already returned
+    unsigned int iteration{0};                  // Iteration within the current block
+    unsigned int iterationsSinceNewBest{0};
+    unsigned int iterationsSinceMigration{0};
+    unsigned int iterationsSinceImprovement{0};
+    bool bNewBestSinceMigration{false};
+    double temperature{0.0};
+    std::chrono::microseconds elapsed{0};       // Time the run had spent of its budget
+    std::chrono::microseconds improvedAt{0};    // When in that time the run last found a new best
+    std::chrono::microseconds sinceImprovement{0};  // Searching time since the last new best
+    std::vector<float> weights;
+    Random ran;
+    std::vector<Random> streams;  // Random streams of speculative candidates
+    SolutionCached best;
+    int bestCost{0};
+    SolutionCached localBest;
+    int localBestCost{0};
+};
+
+/// Where and how often a search saves its state
+struct Checkpoint {
+    std::filesystem::path path;
+    std::chrono::seconds interval{30};
+    bool bResume{false};    // Whether to continue from the state in path, if there is one
+};
+
+/**
+ * @brief Writes state to path in a compact binary format
+ * The state is written to a temporary file that then replaces path, so a run
+ * killed while writing still has its previous checkpoint. Solutions are stored
+ * with the order of their call index, as sampling depends on it.
+ * The format is native endian, so checkpoints aren't portable between machines.
+ */
+std::optional<std::runtime_error> saveSearchState(const std::filesystem::path& path, const SearchState& state);
+
+/// Reads a state written by saveSearchState, checking that it is a state of a search on p
+Result<SearchState, std::runtime_error> loadSearchState(const std::filesystem::path& path, const Problem& p);
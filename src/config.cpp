@@ -0,0 +1,210 @@
+#include "config.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <fstream>
+
+SearchConfig::SearchConfig() {
+    for (const auto& info : operatorRegistry())
+        operators.push_back(OperatorConfig{std::string{info.name}, info.bEnabled, 1.f, info.params});
+}
+
+OperatorConfig* SearchConfig::find(std::string_view name) {
+    const auto it = std::find_if(operators.begin(), operators.end(), [name](const auto& o){ return o.name == name; });
+    return it != operators.end() ? &*it : nullptr;
+}
+
+namespace {
+std::string_view trim(std::string_view str) {
+    const auto first = str.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos)
+        return {};
+    return str.substr(first, str.find_last_not_of(" \t\r") - first + 1);
+}
+
+template <typename T>
+std::optional<T> parse(std::string_view str) {
+    if constexpr (std::is_same_v<T, bool>) {
+        if (str == "true" || str == "on" || str == "1")
+            return true;
+        if (str == "false" || str == "off" || str == "0")
+            return false;
+        return std::nullopt;
+    } else {
+        T value{};
+        const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+        if (ec != std::errc{} || end != str.data() + str.size())
+            return std::nullopt;
+        return value;
+    }
+}
+
+std::runtime_error invalidValue(std::string_view key, std::string_view value) {
+    return std::runtime_error{"Invalid value \"" + std::string{value} + "\" for " + std::string{key}};
+}
+
+template <typename T>
+Result<SearchConfig, std::runtime_error> set(SearchConfig config, T SearchConfig::* field, std::string_view key, std::string_view value) {
+    const auto parsed = parse<T>(value);
+    if (!parsed)
+        return invalidValue(key, value);
+    config.*field = *parsed;
+    return config;
+}
+}
+
+Result<SearchConfig, std::runtime_error> applyOption(SearchConfig config, std::string_view key, std::string_view value) {
+    key = trim(key);
+    value = trim(value);
+
+    if (key == "segment_size") {
+        auto result = set(std::move(config), &SearchConfig::segmentSize, key, value);
+        if (result && result.val().segmentSize == 0)
+            return invalidValue(key, value);
+        return result;
+    }
+    if (key == "escape_condition")
+        return set(std::move(config), &SearchConfig::escapeCondition, key, value);
+    if (key == "replace_weight_ratio") {
+        auto result = set(std::move(config), &SearchConfig::replaceWeightRatio, key, value);
+        if (result && !(0.f <= result.val().replaceWeightRatio && result.val().replaceWeightRatio <= 1.f))
+            return invalidValue(key, value);
+        return result;
+    }
+    if (key == "islands")
+        return set(std::move(config), &SearchConfig::bIslands, key, value);
+    if (key == "shared_best")
+        return set(std::move(config), &SearchConfig::bSharedBest, key, value);
+    if (key == "migration_interval") {
+        auto result = set(std::move(config), &SearchConfig::migrationInterval, key, value);
+        if (result && result.val().migrationInterval == 0)
+            return invalidValue(key, value);
+        return result;
+    }
+    if (key == "speculation") {
+        auto result = set(std::move(config), &SearchConfig::speculation, key, value);
+        if (result && result.val().speculation == 0)
+            return invalidValue(key, value);
+        return result;
+    }
+    if (key == "checkpoint_interval") {
+        auto result = set(std::move(config), &SearchConfig::checkpointInterval, key, value);
+        if (result && result.val().checkpointInterval == 0)
+            return invalidValue(key, value);
+        return result;
+    }
+    if (key == "stall_seconds" || key == "target_gap") {
+        auto result = set(std::move(config), key == "stall_seconds" ? &SearchConfig::stallSeconds : &SearchConfig::targetGap, key, value);
+        if (result && (result.val().stallSeconds < 0.0 || result.val().targetGap < 0.0))
+            return invalidValue(key, value);
+        return result;
+    }
+    if (key == "stall_iterations")
+        return set(std::move(config), &SearchConfig::stallIterations, key, value);
+    if (key == "tabu_tenure")
+        return set(std::move(config), &SearchConfig::tabuTenure, key, value);
+    if (key == "population_size" || key == "offspring" || key == "elite") {
+        const auto field = key == "population_size" ? &SearchConfig::populationSize : key == "offspring" ? &SearchConfig::offspring : &SearchConfig::eliteCount;
+        auto result = set(std::move(config), field, key, value);
+        if (result && result.val().*field == 0)
+            return invalidValue(key, value);
+        return result;
+    }
+    if (key == "exact_calls")
+        return set(std::move(config), &SearchConfig::exactCalls, key, value);
+    if (key == "exact_nodes") {
+        auto result = set(std::move(config), &SearchConfig::exactNodes, key, value);
+        if (result && result.val().exactNodes == 0)
+            return invalidValue(key, value);
+        return result;
+    }
+    if (key == "target_cost" || key == "lower_bound") {
+        auto result = set(std::move(config), key == "target_cost" ? &SearchConfig::targetCost : &SearchConfig::lowerBound, key, value);
+        if (result && (result.val().targetCost < 0 || result.val().lowerBound < 0))
+            return invalidValue(key, value);
+        return result;
+    }
+    if (key == "speculation_accept") {
+        if (value == "best")
+            config.speculationAccept = SpeculationAccept::Best;
+        else if (value == "first")
+            config.speculationAccept = SpeculationAccept::First;
+        else
+            return invalidValue(key, value);
+        return config;
+    }
+    if (key == "migration_topology") {
+        if (value == "ring")
+            config.migrationTopology = MigrationTopology::Ring;
+        else if (value == "complete")
+            config.migrationTopology = MigrationTopology::Complete;
+        else if (value == "random")
+            config.migrationTopology = MigrationTopology::Random;
+        else
+            return invalidValue(key, value);
+        return config;
+    }
+
+    const auto dot = key.find('.');
+    if (dot == std::string_view::npos)
+        return std::runtime_error{"Unknown setting " + std::string{key}};
+
+    const auto name = key.substr(0, dot);
+    const auto field = key.substr(dot + 1);
+    auto* op = config.find(name);
+    if (!op)
+        return std::runtime_error{"Unknown operator " + std::string{name}};
+
+    if (field == "enabled") {
+        const auto enabled = parse<bool>(value);
+        if (!enabled)
+            return invalidValue(key, value);
+        op->bEnabled = *enabled;
+    } else if (field == "weight") {
+        const auto weight = parse<float>(value);
+        if (!weight || *weight < 0.f)
+            return invalidValue(key, value);
+        op->weight = *weight;
+    } else {
+        const auto param = op->params.find(field);
+        if (param == op->params.end())
+            return std::runtime_error{"Operator " + op->name + " has no parameter " + std::string{field}};
+        const auto number = parse<double>(value);
+        if (!number || !std::isfinite(*number) || *number < 0.0)
+            return invalidValue(key, value);
+        // Parameters with a whole default are counts, the others fractions of the calls
+        const auto defaultValue = findOperator(op->name)->params.find(field)->second;
+        if (std::trunc(defaultValue) == defaultValue
+            ? std::trunc(*number) != *number || std::numeric_limits<index_t>::max() < *number
+            : 1.0 < *number)
+            return invalidValue(key, value);
+        param->second = *number;
+    }
+    return config;
+}
+
+Result<SearchConfig, std::runtime_error> applyOption(SearchConfig config, std::string_view setting) {
+    const auto eq = setting.find('=');
+    if (eq == std::string_view::npos)
+        return std::runtime_error{"Expected key = value, got \"" + std::string{setting} + "\""};
+    return applyOption(std::move(config), setting.substr(0, eq), setting.substr(eq + 1));
+}
+
+Result<SearchConfig, std::runtime_error> loadConfig(const std::string& path, SearchConfig config) {
+    std::ifstream ifs{path};
+    if (!ifs)
+        return std::runtime_error{"Failed to open config file " + path};
+
+    std::string line;
+    for (int lineNumber{1}; std::getline(ifs, line); ++lineNumber) {
+        const auto content = trim(std::string_view{line}.substr(0, line.find('#')));
+        if (content.empty())
+            continue;
+        auto result = applyOption(std::move(config), content);
+        if (!result)
+            return std::runtime_error{path + ":" + std::to_string(lineNumber) + ": " + result.err().what()};
+        config = result.val();
+    }
+    return config;
+}
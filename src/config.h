@@ -0,0 +1,80 @@
+#pragma once
+#include "problem.h"
+#include "registry.h"
+#include "cooperation.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Per search settings of an operator
+struct OperatorConfig {
+    std::string name;
+    bool bEnabled;
+    float weight;           // Initial weight, relative to the other enabled operators
+    OperatorParams params;
+};
+
+/// Which of the speculative candidates of an iteration the search continues with
+enum class SpeculationAccept {
+    Best,   // The cheapest feasible candidate
+    First   // The first candidate (in generation order) that is accepted, or the cheapest if none are
+};
+
+/**
+ * @brief Tunable settings of the adaptive search
+ * Defaults are the values the search has been tuned with, and every
+ * registered operator is listed in registry order.
+ *
+ * Settings are given as key = value pairs, either one per line in a
+ * config file (# starts a comment) or on the command line:
+ *  segment_size, escape_condition, replace_weight_ratio
+ *  islands, migration_interval, migration_topology (ring, complete or random)
+ *  shared_best
+ *  speculation, speculation_accept (best or first)
+ *  checkpoint_interval
+ *  stall_seconds, stall_iterations, target_cost, target_gap, lower_bound
+ *  tabu_tenure
+ *  population_size, offspring, elite
+ *  exact_calls, exact_nodes
+ *  <operator>.enabled = true/false
+ *  <operator>.weight  = initial weight
+ *  <operator>.<param> = any parameter the operator registers
+ */
+struct SearchConfig {
+    unsigned int segmentSize{100};      // Iterations between each weight update
+    unsigned int escapeCondition{700};  // Iterations without a new best before escaping
+    float replaceWeightRatio{0.6f};     // How much of the old weights are replaced by new scores
+    bool bIslands{false};               // Whether parallel runs exchange elite solutions
+    unsigned int migrationInterval{1000};  // Iterations between each migration
+    MigrationTopology migrationTopology{MigrationTopology::Ring};
+    bool bSharedBest{false};            // Whether parallel runs restart from the global best instead of escaping
+    unsigned int speculation{1};        // Candidates generated from the incumbent every iteration, in parallel
+    SpeculationAccept speculationAccept{SpeculationAccept::Best};
+    unsigned int checkpointInterval{30};   // Seconds between each checkpoint, when checkpointing
+    // Stopping rules, checked after every segment. 0 turns a rule off.
+    double stallSeconds{0.0};           // Stop after this many seconds without a new best
+    unsigned int stallIterations{0};    // Stop after this many iterations without a new best
+    int targetCost{0};                  // Stop once the best cost is at most this
+    double targetGap{0.0};              // Stop once the best cost is within this fraction above the lower bound
+    int lowerBound{0};                  // Lower bound for target_gap. 0 computes a simple one from the problem.
+    unsigned int tabuTenure{0};         // Iterations a call can't move back into a vehicle it left, in tabu search. 0 picks one from the instance size.
+    unsigned int populationSize{25};    // Individuals kept in the memetic search
+    unsigned int offspring{8};          // Offspring bred every generation of the memetic search
+    unsigned int eliteCount{4};         // Best individuals the memetic search always keeps, at most population_size - 1
+    unsigned int exactCalls{20};        // Instances with at most this many calls are solved exactly instead of searched. 0 turns it off.
+    std::size_t exactNodes{10'000'000}; // Nodes the exact search visits at most before falling back on the searches
+    std::vector<OperatorConfig> operators;
+
+    SearchConfig();
+
+    OperatorConfig* find(std::string_view name);
+};
+
+/// Applies a single key = value setting
+Result<SearchConfig, std::runtime_error> applyOption(SearchConfig config, std::string_view key, std::string_view value);
+
+/// Applies a single setting written as key = value
+Result<SearchConfig, std::runtime_error> applyOption(SearchConfig config, std::string_view setting);
+
+/// Applies every setting in a config file
+Result<SearchConfig, std::runtime_error> loadConfig(const std::string& path, SearchConfig config = {});
@@ -0,0 +1,57 @@
+#include "cooperation.h"
+
+Archipelago::Archipelago(std::size_t islandCount, MigrationTopology topology)
+    : islandCount{islandCount}, topology{topology}, mailboxes{std::make_unique<Mailbox[]>(islandCount)} {
+}
+
+void Archipelago::emigrate(std::size_t island, const SolutionCached& s, int cost, Random& ran) {
+    if (islandCount < 2)
+        return;
+
+    const auto send = [&](std::size_t to) {
+        mailboxes[to].post(std::make_unique<Migrant>(Migrant{s, cost}));
+    };
+    switch (topology) {
+        case MigrationTopology::Ring:
+            send((island + 1) % islandCount);
+            break;
+        case MigrationTopology::Complete:
+            for (std::size_t to{0}; to < islandCount; ++to)
+                if (to != island)
+                    send(to);
+            break;
+        case MigrationTopology::Random:
+            // Any island but this one
+            send((island + 1 + randomIndex(ran, islandCount - 1)) % islandCount);
+            break;
+    }
+}
+
+SharedBest::~SharedBest() {
+    for (auto* node = head.load(); node != nullptr;) {
+        const auto* previous = node->previous;
+        delete node;
+        node = previous;
+    }
+}
+
+bool SharedBest::publish(const SolutionCached& s, int cost) {
+    // Cheap early out, as most improvements of a single search aren't global ones
+    if (this->cost() <= cost)
+        return false;
+
+    auto* node = new Node{s, cost, nullptr};
+    auto* current = head.load(std::memory_order_acquire);
+    do {
+        if (current != nullptr && current->cost <= cost) {
+            delete node;
+            return false;
+        }
+        node->previous = current;
+    } while (!head.compare_exchange_weak(current, node, std::memory_order_acq_rel, std::memory_order_acquire));
+
+    // Heads only ever get cheaper, but publishers can store their cost out of order
+    for (auto c = bestCost.load(std::memory_order_relaxed); cost < c && !bestCost.compare_exchange_weak(c, cost, std::memory_order_relaxed);)
+        ;
+    return true;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "problem.h"
+#include <atomic>
+#include <limits>
+#include <memory>
+#include "random.h"
+#include <vector>
+
+/// Which islands an island sends its migrants to
+enum class MigrationTopology {
+    Ring,       // The next island
+    Complete,   // Every other island
+    Random      // A random other island every migration
+};
+
+/// Elite solution travelling between islands
+struct Migrant {
+    SolutionCached solution;
+    int cost;
+};
+
+/**
+ * @brief Lock-free single slot mailbox
+ * Posting replaces any migrant that hasn't been picked up yet, since a
+ * newer elite from the same neighbourhood is always at least as useful.
+ * Both ends are a single atomic exchange, so neither side ever waits.
+ */
+class Mailbox {
+public:
+    Mailbox() = default;
+    ~Mailbox() { delete slot.load(); }
+
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    void post(std::unique_ptr<Migrant> migrant) {
+        delete slot.exchange(migrant.release(), std::memory_order_acq_rel);
+    }
+    std::unique_ptr<Migrant> take() {
+        return std::unique_ptr<Migrant>{slot.exchange(nullptr, std::memory_order_acq_rel)};
+    }
+
+private:
+    std::atomic<Migrant*> slot{nullptr};
+};
+
+/**
+ * @brief Set of islands running their own search, exchanging elite solutions
+ * Every island owns one mailbox, which any island sending to it writes into.
+ */
+class Archipelago {
+public:
+    Archipelago(std::size_t islandCount, MigrationTopology topology);
+
+    std::size_t size() const { return islandCount; }
+
+    /// Sends a copy of a solution from island to its neighbours
+    void emigrate(std::size_t island, const SolutionCached& s, int cost, Random& ran);
+    /// Latest migrant sent to island, if any
+    std::unique_ptr<Migrant> immigrate(std::size_t island) { return mailboxes[island].take(); }
+
+private:
+    std::size_t islandCount;
+    MigrationTopology topology;
+    std::unique_ptr<Mailbox[]> mailboxes;
+};
+
+/**
+ * @brief Best solution found by any of the searches of an instance
+ * Every published solution is an immutable node that stays alive until the
+ * SharedBest itself is destroyed, so readers never have to worry about it
+ * being freed under them. Publishing is a compare-and-swap on the head of
+ * the node chain and only ever succeeds with a strictly better cost, so
+ * the head is always the best solution seen.
+ */
+class SharedBest {
+public:
+    struct Node {
+        SolutionCached solution;
+        int cost;
+        const Node* previous;
+    };
+
+    SharedBest() = default;
+    ~SharedBest();
+
+    SharedBest(const SharedBest&) = delete;
+    SharedBest& operator=(const SharedBest&) = delete;
+
+    /**
+     * @brief Cost of the best published solution. Cheap enough to check every iteration.
+     * Only a hint, as it isn't ordered with the head: best() can still be an
+     * older node for a while. Use better() to get a solution to continue from.
+     */
+    int cost() const { return bestCost.load(std::memory_order_relaxed); }
+    /// Best published solution, or nullptr if there is none
+    const Node* best() const { return head.load(std::memory_order_acquire); }
+    /// Best published solution if it is strictly cheaper than cost, otherwise nullptr
+    const Node* better(int cost) const {
+        const auto* node = best();
+        return node != nullptr && node->cost < cost ? node : nullptr;
+    }
+    /// Publishes a solution if it's better than the current best. Returns whether it was.
+    bool publish(const SolutionCached& s, int cost);
+
+private:
+    std::atomic<const Node*> head{nullptr};
+    std::atomic<int> bestCost{std::numeric_limits<int>::max()};
+};
+
+/// How a single search cooperates with the other searches of the same instance
+struct Cooperation {
+    Archipelago* archipelago{nullptr};  // Island model, if set
+    std::size_t island{0};              // Island of this search in the archipelago
+    unsigned int migrationInterval{0};  // Iterations between each migration
+    SharedBest* sharedBest{nullptr};    // Restart from the global best instead of escaping, if set
+};
@@ -3,6 +3,7 @@
 #include <unordered_set>
 #include <utility>
 #include <algorithm>
+#include <limits>
 
 Result<int, std::runtime_error> getCost(const Problem &problem, const Solution& solution) {
     int totalCost{0};
@@ -158,6 +159,10 @@ Result<int, std::runtime_error> getCost(const Problem &problem, const SolutionCo
 }
 
 FeasibilityCostRet getFeasibleCost(const Problem& p, SolutionCached& s) {
+#ifndef NDEBUG
+    if (!s.index.empty() && !s.index.consistent(s))
+        return std::runtime_error{"Call index out of sync with routes."};
+#endif
     int totalCost{0};
     for (index_t i{0}; i < s.size(); ++i) {
         // If it was not changed but don't have a cost either, it's infeasible
@@ -325,3 +330,18 @@ FeasibilityCostRet getFeasibleCost(const Problem& p, SolutionCached& s) {
 
     return totalCost;
 }
+
+int costLowerBound(const Problem& p) {
+    // Every call costs at least the cheapest of leaving it and the node costs of
+    // any vehicle that can take it. Travel is left out, as consecutive stops at
+    // the same node travel for free.
+    long long bound{0};
+    for (index_t c{0}; c < p.calls.size(); ++c) {
+        auto cheapest = p.calls[c].costOfNotTransporting;
+        for (index_t v{0}; v < p.vehicles.size(); ++v)
+            if (p.canTake(v, c))
+                cheapest = std::min(cheapest, p.vehicleCall(v, c).originNodeCosts + p.vehicleCall(v, c).destNodeCosts);
+        bound += cheapest;
+    }
+    return static_cast<int>(std::min<long long>(bound, std::numeric_limits<int>::max()));
+}
@@ -20,4 +20,10 @@ public:
     auto val_or_max() const { return *(*this); }
 };
 #endif
-FeasibilityCostRet getFeasibleCost(const Problem& p, SolutionCached& s);
\ No newline at end of file
+FeasibilityCostRet getFeasibleCost(const Problem& p, SolutionCached& s);
+/**
+ * @brief Cost no solution of p can go below
+ * Quick to compute, but loose: it only counts the cheapest way to handle
+ * every call on its own.
+ */
+int costLowerBound(const Problem& p);
@@ -0,0 +1,204 @@
+#include "exact.h"
+#include "schedule.h"
+#include "cost.h"
+#include "heuristics.h"
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+bool triangleInequality(const Problem& p) {
+    std::vector<index_t> nodes;
+    for (index_t v{0}; v < p.vehicles.size(); ++v) {
+        // Only the nodes the vehicle can ever visit
+        nodes.assign({p.vehicles[v].homeNodeIndex});
+        for (index_t c{0}; c < p.calls.size(); ++c) {
+            if (p.canTake(v, c)) {
+                nodes.push_back(p.calls[c].origin);
+                nodes.push_back(p.calls[c].destination);
+            }
+        }
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+        for (const auto a : nodes)
+            for (const auto b : nodes)
+                for (const auto c : nodes)
+                    if (static_cast<long long>(p.travelCost(v, a, b)) + p.travelCost(v, b, c) < p.travelCost(v, a, c) ||
+                        static_cast<long long>(p.travelTime(v, a, b)) + p.travelTime(v, b, c) < p.travelTime(v, a, c))
+                        return false;
+    }
+    return true;
+}
+
+namespace {
+class BranchAndBound {
+public:
+    BranchAndBound(const Problem& p, std::size_t nodeLimit)
+        : p{p}, callCount{static_cast<index_t>(p.calls.size())}, vCount{static_cast<index_t>(p.vehicles.size())}, nodeLimit{nodeLimit},
+          order(callCount), rest(callCount + 1, 0), masks(vCount + 1, 0), costs(vCount + 1, 0), memo(vCount), children(callCount) {
+        // Cheapest any call can cost: handling it in the cheapest vehicle, or not transporting it
+        std::vector<int> cheapest(callCount);
+        std::vector<index_t> options(callCount, 0);
+        for (index_t c{0}; c < callCount; ++c) {
+            cheapest[c] = p.calls[c].costOfNotTransporting;
+            for (index_t v{0}; v < vCount; ++v) {
+                if (!p.canTake(v, c))
+                    continue;
+                const auto& vc = p.vehicleCall(v, c);
+                cheapest[c] = std::min(cheapest[c], vc.originNodeCosts + vc.destNodeCosts);
+                ++options[c];
+            }
+        }
+        // Fewest vehicles first, then the most expensive to leave out, so the tree is narrow near the root
+        std::iota(order.begin(), order.end(), index_t{0});
+        std::sort(order.begin(), order.end(), [&](index_t a, index_t b) {
+            return std::tuple{options[a], -p.calls[a].costOfNotTransporting, a} < std::tuple{options[b], -p.calls[b].costOfNotTransporting, b};
+        });
+        for (std::size_t d{callCount}; 0 < d; --d)
+            rest[d - 1] = rest[d] + cheapest[order[d - 1]];
+        for (auto& c : children)
+            c.reserve(vCount + 1);
+    }
+
+    void solve(int upperBound) {
+        bestCost = upperBound;
+        branch(0, 0);
+    }
+
+    int bestCost{std::numeric_limits<int>::max()};
+    std::vector<std::uint64_t> bestMasks;   // [vehicle] Calls of every vehicle in the best solution found, if any
+    std::size_t nodes{0};
+    bool bComplete{true};   // Whether no branch was skipped for other reasons than its bound
+
+private:
+    struct Entry {
+        int cost;
+        bool bExact;    // Otherwise the route costs at least cost, or is infeasible
+    };
+
+    std::uint64_t bit(index_t call) const { return std::uint64_t{1} << call; }
+
+    /// Cost of the cheapest route of the calls in mask, if cheaper than limit
+    std::optional<int> routeCost(index_t v, std::uint64_t mask, int limit) {
+        auto [it, bNew] = memo[v].try_emplace(mask, Entry{0, false});
+        auto& entry = it->second;
+        if (!bNew) {
+            if (entry.bExact)
+                return entry.cost < limit ? std::optional{entry.cost} : std::nullopt;
+            if (limit <= entry.cost)
+                return std::nullopt;
+        }
+        if (MAX_RESEQUENCE_CALLS < static_cast<std::size_t>(std::popcount(mask))) {
+            bComplete = false;
+            entry = Entry{std::numeric_limits<int>::max(), true};
+            return std::nullopt;
+        }
+
+        route.clear();
+        for (auto m = mask; m != 0; m &= m - 1) {
+            const auto c = static_cast<index_t>(std::countr_zero(m));
+            route.push_back(c);
+            route.push_back(c);
+        }
+        const auto optimal = optimalRoute(p, v, route, limit);
+        if (!optimal) {
+            entry = Entry{limit, false};
+            return std::nullopt;
+        }
+        buildSchedule(p, v, *optimal, schedule);
+        entry = Entry{schedule.route().cost, true};
+        return entry.cost;
+    }
+
+    void branch(std::size_t depth, int cost) {
+        if (nodeLimit <= ++nodes) {
+            bComplete = false;
+            return;
+        }
+        if (depth == callCount) {
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestMasks = masks;
+            }
+            return;
+        }
+
+        // Every way to place the next call, cheapest first
+        const auto call = order[depth];
+        auto& options = children[depth];
+        options.clear();
+        for (index_t v{0}; v < vCount; ++v) {
+            if (!p.canTake(v, call))
+                continue;
+            const auto others = cost - costs[v];
+            if (const auto c = routeCost(v, masks[v] | bit(call), bestCost - rest[depth + 1] - others))
+                options.emplace_back(others + *c, v);
+        }
+        options.emplace_back(cost + p.calls[call].costOfNotTransporting, vCount);
+        std::sort(options.begin(), options.end());
+
+        for (const auto& [childCost, v] : options) {
+            if (bestCost <= childCost + rest[depth + 1])
+                break;
+            const auto previous = costs[v];
+            masks[v] |= bit(call);
+            costs[v] = childCost - (cost - previous);
+            branch(depth + 1, childCost);
+            masks[v] &= ~bit(call);
+            costs[v] = previous;
+            if (nodeLimit <= nodes)
+                return;
+        }
+    }
+
+    const Problem& p;
+    index_t callCount;
+    index_t vCount;
+    std::size_t nodeLimit;
+    std::vector<index_t> order;             // Calls in the order they are branched on
+    std::vector<int> rest;                  // [depth] Lower bound of what the calls from depth on cost
+    std::vector<std::uint64_t> masks;       // [vehicle] Calls assigned so far, with the dummy last
+    std::vector<int> costs;                 // [vehicle] Cost of the assigned calls
+    std::vector<std::unordered_map<std::uint64_t, Entry>> memo;    // [vehicle] Route cost by set of calls
+    std::vector<std::vector<std::pair<int, index_t>>> children;    // [depth] Options being branched on
+    Route route;
+    RouteSchedule schedule;
+};
+}
+
+ExactResult branchAndBound(const Problem& p, const SolutionCached* incumbent, std::size_t nodeLimit) {
+    const auto vCount = static_cast<index_t>(p.vehicles.size());
+    ExactResult result{incumbent != nullptr ? *incumbent : genInitialSolutionCached(p), 0, false, 0};
+    const auto initialCost = getFeasibleCost(p, result.solution);
+    result.cost = initialCost ? initialCost.val() : std::numeric_limits<int>::max();
+    if (MAX_EXACT_CALLS < p.calls.size())
+        return result;
+
+    // Known before branching, as no search can prove optimality without it
+    const auto bMetric = triangleInequality(p);
+    BranchAndBound search{p, nodeLimit};
+    search.solve(result.cost);
+    result.nodes = search.nodes;
+    result.bOptimal = search.bComplete && bMetric;
+    if (search.bestMasks.empty())
+        return result;
+
+    // Only the call sets were kept, so the routes are sequenced again
+    auto& s = result.solution;
+    s.assign(vCount + 1, VehicleSolution{});
+    s.index.clear();
+    for (index_t v{0}; v <= vCount; ++v) {
+        for (auto m = search.bestMasks[v]; m != 0; m &= m - 1) {
+            const auto c = static_cast<index_t>(std::countr_zero(m));
+            s[v].calls.push_back(c);
+            s[v].calls.push_back(c);
+        }
+        if (v < vCount && !s[v].calls.empty())
+            s[v].calls = *optimalRoute(p, v, s[v].calls);
+    }
+    const auto cost = getFeasibleCost(p, s);
+    result.cost = cost ? cost.val() : std::numeric_limits<int>::max();
+    return result;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "problem.h"
+#include <cstddef>
+#include <cstdint>
+
+/// Largest amount of calls branchAndBound can solve
+constexpr std::size_t MAX_EXACT_CALLS = 64;
+
+struct ExactResult {
+    SolutionCached solution;
+    int cost;
+    bool bOptimal;          // Whether the search proved that nothing is cheaper
+    std::size_t nodes;      // Nodes of the search tree visited
+};
+
+/**
+ * @brief Exact branch and bound over which vehicle (or the dummy) takes each call
+ * Calls are assigned one at a time, most constrained first, and every vehicle
+ * is sequenced optimally by optimalRoute whenever it gets a new call, so a
+ * node's cost is exact for the calls assigned so far. Branches are cut when
+ * that cost plus the cheapest handling (or not transporting) of every
+ * remaining call can't beat the best solution found. Route costs are memoized
+ * per vehicle and set of calls, as the same sets come up in many branches.
+ *
+ * The bound relies on adding a call to a route never making the rest of the
+ * route cheaper or faster, which holds when travel costs and times satisfy
+ * the triangle inequality. The result is only claimed optimal if they do, if
+ * no vehicle would need more than MAX_RESEQUENCE_CALLS calls and if the whole
+ * tree was searched within nodeLimit nodes.
+ * @param incumbent Known solution to start from. Only strictly cheaper solutions
+ * replace it, so proving a good incumbent optimal is much quicker than finding it.
+ * @param nodeLimit Nodes to visit at most before giving up on proving optimality
+ * @return Best solution found. With more than MAX_EXACT_CALLS calls the search
+ * isn't run, and the incumbent (or every call in the dummy) is returned.
+ */
+ExactResult branchAndBound(const Problem& p, const SolutionCached* incumbent = nullptr, std::size_t nodeLimit = 10'000'000);
+
+/// Whether travel costs and times of every vehicle satisfy the triangle inequality
+bool triangleInequality(const Problem& p);
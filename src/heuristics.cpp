@@ -2,8 +2,14 @@
 #include "operators.h"
 #include "cost.h"
 #include "feasibility.h"
+#include "config.h"
+#include "cooperation.h"
+#include "threadpool.h"
+#include "checkpoint.h"
+#include "schedule.h"
+#include "tabu.h"
+#include "exact.h"
 #include <random>
-#include <ctime>
 #include <numbers>
 #include <cmath>
 #include <iostream>
@@ -14,6 +20,8 @@
 #include "zip.hpp"
 #include <functional>
 #include <chrono>
+#include <limits>
+#include <span>
 
 Solution genInitialSolution(const Problem& p) {
     Solution routes;
@@ -40,14 +48,7 @@ SolutionCached genInitialSolutionCached(const Problem& p) {
     return routes;
 }
 
-Solution genRandSolution(const Problem& p) {
-    // Random engine, seeded by current time.
-    static std::default_random_engine engine{static_cast<unsigned int>(std::time(nullptr))};
-
-    return genRandSolution(p, engine);
-}
-
-Solution genRandSolution(const Problem& p, std::default_random_engine& ran) {
+Solution genRandSolution(const Problem& p, Random& ran) {
     Solution routes;
     const auto vSize{p.vehicles.size()};
     routes.resize(vSize+1);
@@ -59,7 +60,7 @@ Solution genRandSolution(const Problem& p, std::default_random_engine& ran) {
     std::shuffle(remainingCalls.begin(), remainingCalls.end(), ran);
 
     while (!remainingCalls.empty()) {
-        routes.at(ran() % (vSize+1)).push_back(remainingCalls.back());
+        routes.at(randomIndex(ran, vSize+1)).push_back(remainingCalls.back());
         remainingCalls.pop_back();
     }
 
@@ -72,7 +73,7 @@ Solution genRandSolution(const Problem& p, std::default_random_engine& ran) {
     return routes;
 }
 
-SolutionCached genRandSolutionCached(const Problem& p, std::default_random_engine& ran) {
+SolutionCached genRandSolutionCached(const Problem& p, Random& ran) {
     SolutionCached routes;
     const auto vSize{p.vehicles.size()};
     routes.resize(vSize+1);
@@ -84,7 +85,7 @@ SolutionCached genRandSolutionCached(const Problem& p, std::default_random_engin
     std::shuffle(remainingCalls.begin(), remainingCalls.end(), ran);
 
     while (!remainingCalls.empty()) {
-        routes.at(ran() % (vSize+1)).calls.push_back(remainingCalls.back());
+        routes.at(randomIndex(ran, vSize+1)).calls.push_back(remainingCalls.back());
         remainingCalls.pop_back();
     }
 
@@ -97,15 +98,17 @@ SolutionCached genRandSolutionCached(const Problem& p, std::default_random_engin
     return routes;
 }
 
-Solution blindRandomSearch(const Problem& p, std::default_random_engine& ran) {
+Solution blindRandomSearch(const Problem& p, Random& ran) {
     constexpr int MAX_SEARCH = 10000;
 
     
     auto best = fromNestedListZeroIndexed(genInitialSolution(p)); // init to dummy solution
     auto cost = getCost(p, best).val_or_max();
 
+    SolutionComp current;
+    current.reserve(best.size());
     for (int i{0}; i < MAX_SEARCH; ++i) {
-        const auto current = fromNestedListZeroIndexed(genRandSolution(p, ran));
+        fromNestedListZeroIndexed(genRandSolution(p, ran), current);
         const auto result = checkfeasibility(p, current);
         if (!result) {
             const auto newCost = getCost(p, current).val_or_max();
@@ -120,14 +123,14 @@ Solution blindRandomSearch(const Problem& p, std::default_random_engine& ran) {
     return toNestedList(best);
 }
 
-Solution localSearch(const Problem& p, std::default_random_engine& ran) {
+Solution localSearch(const Problem& p, Random& ran) {
     constexpr int MAX_SEARCH = 10000;
     // Available operators
-    const std::vector operators{
+    const auto operators = std::to_array<SolutionComp (*)(SolutionComp, Random&)>({
         op::ex2_comp,
         op::ex3_comp,
         op::ins1_comp
-    };
+    });
 
 
     auto best = fromNestedListZeroIndexed(genInitialSolution(p)); // init to dummy solution
@@ -135,8 +138,8 @@ Solution localSearch(const Problem& p, std::default_random_engine& ran) {
 
     for (int i{0}; i < MAX_SEARCH; ++i) {
         // Use random operator
-        const auto r{ran() % 100 * 0.01f};
-        const auto current{r < 0.4f ? operators[0](best) : r < 0.4f + 0.3f ? operators[1](best) : operators[2](best)};
+        const auto r{static_cast<float>(randomUnit(ran))};
+        const auto current{r < 0.4f ? operators[0](best, ran) : r < 0.4f + 0.3f ? operators[1](best, ran) : operators[2](best, ran)};
 
         const auto result = checkfeasibility(p, current);
         if (!result) {
@@ -152,10 +155,10 @@ Solution localSearch(const Problem& p, std::default_random_engine& ran) {
     return toNestedList(best);
 }
 
-Solution simulatedAnnealing(const Problem& p, std::default_random_engine& ran) {
+Solution simulatedAnnealing(const Problem& p, Random& ran) {
     constexpr int MAX_SEARCH = 10000;
     // Available operators
-    const auto operators = std::to_array<Solution (*)(Solution)>({
+    const auto operators = std::to_array<Solution (*)(Solution, Random&)>({
         &op::ex2,
         &op::ex3,
         &op::ins1
@@ -177,13 +180,13 @@ Solution simulatedAnnealing(const Problem& p, std::default_random_engine& ran) {
     };
 
     const auto rand = [&](){
-        return ran() % 1000000 * 0.000001;
+        return randomUnit(ran);
     };
 
     for (int i{0}; i < MAX_SEARCH; ++i, temperature *= coolingFactor) {
         // Use random operator
-        const auto r = ran() % 100 * 0.01f;
-        const auto current = r < 0.4f ? operators[0](incumbent) : r < 0.4f + 0.3f ? operators[1](incumbent) : operators[2](incumbent);
+        const auto r = static_cast<float>(randomUnit(ran));
+        const auto current = r < 0.4f ? operators[0](incumbent, ran) : r < 0.4f + 0.3f ? operators[1](incumbent, ran) : operators[2](incumbent, ran);
 
         // Check if solution is feasible
         const auto result = checkfeasibility(p, current);
@@ -219,10 +222,10 @@ Solution simulatedAnnealing(const Problem& p, std::default_random_engine& ran) {
     return best;
 }
 
-Solution simulatedAnnealing2ElectricBoogaloo(const Problem& p, std::default_random_engine& ran) {
+Solution simulatedAnnealing2ElectricBoogaloo(const Problem& p, Random& ran) {
     constexpr int MAX_SEARCH = 10000;
     // Available operators
-    const auto operators = std::to_array<Solution(*)(const Problem&, Solution)>({
+    const auto operators = std::to_array<Solution(*)(const Problem&, Solution, Random&)>({
         op::fesins,
         op::freorder,
         op::backinsert,
@@ -244,13 +247,13 @@ Solution simulatedAnnealing2ElectricBoogaloo(const Problem& p, std::default_rand
     };
 
     const auto rand = [&](){
-        return ran() % 1000000 * 0.000001;
+        return randomUnit(ran);
     };
 
     for (int i{0}; i < MAX_SEARCH; ++i, temperature *= coolingFactor) {
         // Use random operator
-        const auto r = ran() % 100 * 0.01f;
-        const auto current = r < 0.65f ? operators[0](p, incumbent) : r < 0.27f + 0.08f ? operators[1](p, incumbent) : operators[2](p, incumbent);
+        const auto r = static_cast<float>(randomUnit(ran));
+        const auto current = r < 0.65f ? operators[0](p, incumbent, ran) : r < 0.27f + 0.08f ? operators[1](p, incumbent, ran) : operators[2](p, incumbent, ran);
 
         // Check if solution is feasible
         const auto result = checkfeasibility(p, current);
@@ -296,26 +299,18 @@ void operator+=(std::pair<T,U> & l,const std::pair<T,U> & r) {
     l = l + r;
 }
 
-Solution adaptiveSearch(const Problem& p) {
-    // Random engine, seeded by current time.
-    static std::default_random_engine engine{static_cast<unsigned int>(std::time(nullptr))};
-
-    return adaptiveSearch(p, engine);
-}
-
-Solution adaptiveSearch(const Problem& p, std::default_random_engine& ran) {
+Solution adaptiveSearch(const Problem& p, Random& ran) {
     constexpr unsigned int MAX_SEARCH = 10000;
     constexpr unsigned int SEGMENT_SIZE = 100;
     constexpr unsigned int ESCAPE_CONDITION = 1000;
     constexpr float MIN_WEIGHT = 0.05f;
     constexpr float REPLACE_WEIGHT_RATIO = 0.5f;
 
-    const auto fesins = [&](Solution s){ return op::fesins(p, s); };
     // Available operators (heuristics)
     const auto operators = std::to_array<std::function<Solution(Solution)>>({
-        [](auto s){ return op::ex2(s); },
-        [](auto s){ return op::ins1(s); },
-        [&p](Solution s){ return op::fesins(p, s); },
+        [&ran](Solution s){ return op::ex2(s, ran); },
+        [&ran](Solution s){ return op::ins1(s, ran); },
+        [&p, &ran](Solution s){ return op::fesins(p, s, ran); },
     });
 
     std::array<float, operators.size()> weights;
@@ -336,7 +331,7 @@ Solution adaptiveSearch(const Problem& p, std::default_random_engine& ran) {
     double coolingFactor = std::exp(std::log(0.01 / temperature) / MAX_SEARCH);
 
     const auto rand = [&](){
-        return ran() % 1000000 * 0.000001;
+        return randomUnit(ran);
     };
 
     // Note: Annoying that c++ doesnt have const reference captures
@@ -363,7 +358,7 @@ Solution adaptiveSearch(const Problem& p, std::default_random_engine& ran) {
         for (unsigned int j{0}; j < SEGMENT_SIZE; ++i, ++j, ++iterationsSinceNewBest, temperature *= coolingFactor) {
             if (ESCAPE_CONDITION < iterationsSinceNewBest) {
                 // Apply escape algorithm (something to bring us out of local optima)
-                localBest = op::freorder(p, localBest);
+                localBest = op::freorder(p, localBest, ran);
                 const auto cost = getCost(p, localBest);
                 if (!cost)
                     throw std::logic_error{"What?"};
@@ -431,34 +426,248 @@ Solution adaptiveSearch(const Problem& p, std::default_random_engine& ran) {
     return best;
 }
 
-SolutionCached adaptiveCachedSearch(const Problem& p, std::default_random_engine& ran, const std::chrono::high_resolution_clock::time_point* p_start, long long availableTime) {
+std::string_view describe(StopReason reason) {
+    switch (reason) {
+        case StopReason::Iterations: return "iteration limit";
+        case StopReason::TimeBudget: return "time budget used up";
+        case StopReason::Converged: return "converged (time budget)";
+        case StopReason::StallTime: return "no improvement for stall_seconds";
+        case StopReason::StallIterations: return "no improvement for stall_iterations";
+        case StopReason::TargetCost: return "reached target_cost";
+        case StopReason::TargetGap: return "reached target_gap";
+        case StopReason::Resumed: return "already finished";
+        case StopReason::Optimal: return "proved optimal";
+    }
+    return "unknown";
+}
+
+namespace {
+/// Stopping rules from SearchConfig, and the time budget when running for 10 minutes
+struct StopRules {
+    const SearchConfig& config;
+    TimeBudget::Run* budget;
+    int lowerBound;
+    unsigned int iterationsSinceImprovement{0};
+    std::chrono::steady_clock::time_point lastImprovement{std::chrono::steady_clock::now()};
+
+    StopRules(const Problem& p, const SearchConfig& config, TimeBudget::Run* budget)
+        : config{config}, budget{budget},
+          lowerBound{0.0 < config.targetGap ? (config.lowerBound != 0 ? config.lowerBound : costLowerBound(p)) : 0} {
+    }
+
+    void improved() {
+        iterationsSinceImprovement = 0;
+        lastImprovement = std::chrono::steady_clock::now();
+    }
+
+    /// The first rule that says to stop, if any
+    std::optional<StopReason> check(int bestCost) const {
+        if (0 < config.targetCost && bestCost <= config.targetCost)
+            return StopReason::TargetCost;
+        if (0.0 < config.targetGap && bestCost <= lowerBound * (1.0 + config.targetGap))
+            return StopReason::TargetGap;
+        if (0 < config.stallIterations && config.stallIterations <= iterationsSinceImprovement)
+            return StopReason::StallIterations;
+        if (0.0 < config.stallSeconds && std::chrono::duration<double>{config.stallSeconds} <= std::chrono::steady_clock::now() - lastImprovement)
+            return StopReason::StallTime;
+#ifdef RUN_FOR_10_MINUTES
+        if (budget != nullptr && budget->expired())
+            return budget->converged() ? StopReason::Converged : StopReason::TimeBudget;
+#endif
+        return std::nullopt;
+    }
+};
+
+/**
+ * @brief Incremental evaluation of moving single calls between vehicles and the dummy
+ * Keeps every vehicle's schedule, the cheapest insertion of every call into
+ * every vehicle, and what taking each call out of where it is saves. A move
+ * only changes two vehicles, so only those are reevaluated. Buffers are kept
+ * between solutions, so evaluating one solution after another doesn't allocate.
+ */
+class Relocations {
+public:
+    struct Move {
+        index_t call;
+        index_t to;
+        int delta;  // Change in the cost of the whole solution
+    };
+
+    explicit Relocations(const Problem& p)
+        : p{p}, callCount{static_cast<index_t>(p.calls.size())}, vCount{static_cast<index_t>(p.vehicles.size())},
+          schedules(vCount), options(static_cast<std::size_t>(callCount) * vCount), removalGains(callCount), allVehicles(vCount) {
+        std::iota(allVehicles.begin(), allVehicles.end(), index_t{0});
+    }
+
+    /// Starts evaluating moves on s, which is changed by apply and has to outlive the use of it
+    void reset(SolutionCached& solution, ThreadPool* pool = nullptr) {
+        s = &solution;
+        index = &callIndex(solution);
+        for (const auto c : index->unservedCalls())
+            removalGains[c] = p.calls[c].costOfNotTransporting;
+        refresh(allVehicles, pool);
+    }
+
+    /// Cheapest move that admissible(call, to, delta) allows, picking randomly between ties
+    template <typename Admissible>
+    std::optional<Move> best(Admissible&& admissible, Random& ran) const {
+        std::optional<Move> move;
+        unsigned int ties{0};
+        for (index_t c{0}; c < callCount; ++c) {
+            const auto& gain = removalGains[c];
+            if (!gain)
+                continue;
+            const auto from = index->vehicleOf(c);
+            for (index_t v{0}; v <= vCount; ++v) {
+                if (v == from)
+                    continue;
+                int insertCost;
+                if (v == vCount)
+                    insertCost = p.calls[c].costOfNotTransporting;
+                else if (const auto& o = options[c * vCount + v])
+                    insertCost = o->delta;
+                else
+                    continue;
+
+                const auto delta = insertCost - *gain;
+                if ((move && move->delta < delta) || !admissible(c, v, delta))
+                    continue;
+                if (!move || delta < move->delta) {
+                    move = Move{c, v, delta};
+                    ties = 1;
+                } else if (randomIndex(ran, ++ties) == 0) {
+                    move = Move{c, v, delta};
+                }
+            }
+        }
+        return move;
+    }
+
+    /// Applies move to the solution and reevaluates what it changed. Returns the vehicle the call left.
+    index_t apply(const Move& move, ThreadPool* pool = nullptr) {
+        auto& solution = *s;
+        const auto [call, to, delta] = move;
+        const auto from = index->vehicleOf(call);
+        erase(solution[from].calls, call);
+        solution[from].bChanged = true;
+        if (to == vCount) {
+            solution[to].calls.push_back(call);
+            solution[to].calls.push_back(call);
+            removalGains[call] = p.calls[call].costOfNotTransporting;
+        } else {
+            applyInsertion(solution[to].calls, *options[call * vCount + to]);
+        }
+        solution[to].bChanged = true;
+        index->assign(call, to);
+
+        std::array<index_t, 2> changed;
+        std::size_t changedCount{0};
+        for (const auto v : {from, to})
+            if (v != vCount)
+                changed[changedCount++] = v;
+        refresh(std::span{changed.data(), changedCount}, pool);
+        return from;
+    }
+
+private:
+    // Touches only what belongs to vehicle v, so vehicles can be refreshed in parallel
+    void refreshVehicle(index_t v) {
+        const auto& route = (*s)[v].calls;
+        buildSchedule(p, v, route, schedules[v]);
+        for (std::size_t i{0}; i < route.size(); ++i) {
+            const auto j = static_cast<std::size_t>(std::find(route.begin() + i + 1, route.end(), route[i]) - route.begin());
+            if (j == route.size())
+                continue; // Delivery, already handled by its pickup
+            const auto seg = removalSegment(p, schedules[v], i, j);
+            removalGains[route[i]] = feasible(p, v, seg) ? std::optional<int>{schedules[v].route().cost - seg.cost} : std::nullopt;
+        }
+        for (index_t c{0}; c < callCount; ++c)
+            options[c * vCount + v] = index->vehicleOf(c) != v ? bestInsertion(p, schedules[v], c) : std::nullopt;
+    }
+
+    void refresh(std::span<const index_t> vehicles, ThreadPool* pool) {
+        if (pool != nullptr)
+            pool->parallelFor(vehicles.size(), [&](std::size_t i){ refreshVehicle(vehicles[i]); });
+        else
+            for (const auto v : vehicles)
+                refreshVehicle(v);
+    }
+
+    const Problem& p;
+    index_t callCount;
+    index_t vCount;
+    SolutionCached* s{nullptr};
+    CallIndex* index{nullptr};
+    std::vector<RouteSchedule> schedules;
+    std::vector<std::optional<Insertion>> options;  // [call][vehicle]
+    std::vector<std::optional<int>> removalGains;   // Nothing if the route would be infeasible without the call
+    std::vector<index_t> allVehicles;
+};
+}
+
+SolutionCached adaptiveCachedSearch(const Problem& p, Random& ran, TimeBudget::Run* budget, ThreadPool* pool, const SearchConfig* p_config, const Cooperation* cooperation, const Checkpoint* checkpoint, const ImprovementObserver* observer, SearchScratch* p_scratch, StopReason* p_stopReason) {
+    static const SearchConfig defaultConfig{};
+    const auto& config = p_config != nullptr ? *p_config : defaultConfig;
+
     constexpr unsigned int MAX_SEARCH = 100000;
-    constexpr unsigned int SEGMENT_SIZE = 100;
-    constexpr unsigned int ESCAPE_CONDITION = 700;
-    constexpr float REPLACE_WEIGHT_RATIO = 0.6f;
+    const unsigned int SEGMENT_SIZE = std::max(config.segmentSize, 1u);
+    const unsigned int ESCAPE_CONDITION = config.escapeCondition;
+    const float REPLACE_WEIGHT_RATIO = config.replaceWeightRatio;
 
     // using Clock = std::chrono::high_resolution_clock;
     // Clock::time_point t1, t2;
 
-    // Available operators (heuristics)
-    using OperatorSignature = std::function<SolutionCached(SolutionCached)>;
-    const auto operators = std::to_array<OperatorSignature>({
-        [&ran](auto s){ return op::ex2(s, ran); },
-        [&p, &ran](auto s){ return op::freorder(p, s, ran); },
-        // [&p, &ran](auto s){ return op::fesins(p, s, ran); },
-        [&ran](auto s){ return op::ins1(s, ran); },
-        [&p, &ran](auto s){ return op::priceinsert(p, s, ran); },
-        [&p, &ran](auto s){ return op::validins(p, s, ran); },
-        // [&ran](auto s){ return op::shuffle(s, ran); },
-    });
+    // Available operators (heuristics), built from the registry with their configured parameters
+    const auto makeOperators = [&](Random& engine) {
+        std::vector<OperatorSignature> out;
+        for (const auto& oc : config.operators)
+            if (oc.bEnabled && 0.f < oc.weight)
+                out.push_back(findOperator(oc.name)->make(OperatorContext{p, engine, pool, oc.params}));
+        return out;
+    };
+    const auto operators = makeOperators(ran);
+    std::vector<float> weights;
+    for (const auto& oc : config.operators)
+        if (oc.bEnabled && 0.f < oc.weight)
+            weights.push_back(oc.weight);
+    if (operators.empty())
+        throw std::runtime_error{"No operators enabled"};
+
+    // Speculative candidates are generated concurrently, so each one gets
+    // its own random stream and its own operators drawing from it.
+    const unsigned int SPECULATION = std::max(config.speculation, 1u);
+    std::vector<Random> streams;
+    std::vector<std::vector<OperatorSignature>> streamOperators;
+    if (1 < SPECULATION) {
+        streams.reserve(SPECULATION);
+        // Stream k starts k + 1 jumps ahead of the search's own stream, so none of them overlap
+        auto stream = ran;
+        for (unsigned int k{0}; k < SPECULATION; ++k) {
+            stream.jump();
+            streams.push_back(stream);
+        }
+        for (auto& stream : streams)
+            streamOperators.push_back(makeOperators(stream));
+    }
+    SearchScratch localScratch;
+    auto& scratch = p_scratch != nullptr ? *p_scratch : localScratch;
+    auto& candidatePicks = scratch.candidatePicks;
+    auto& candidateOperators = scratch.candidateOperators;
+    auto& candidates = scratch.candidates;
+    auto& candidateCosts = scratch.candidateCosts;
+    candidatePicks.resize(SPECULATION);
+    candidateOperators.resize(SPECULATION);
+    candidates.resize(SPECULATION);
+    candidateCosts.resize(SPECULATION);
 
     // std::array<std::pair<unsigned int, long long>, operators.size()> operatorEfficiency;
 
     const float MIN_WEIGHT = 0.8f / operators.size();
 
-    std::array<float, operators.size()> weights;
+    // Initial weights are relative, so normalize them
+    const auto initialSum = std::accumulate(weights.begin(), weights.end(), 0.f);
     for (auto& w : weights)
-        w = 1.f / weights.size();
+        w /= initialSum;
 
 
     auto best = genInitialSolutionCached(p); // init to dummy solution
@@ -472,6 +681,15 @@ SolutionCached adaptiveCachedSearch(const Problem& p, std::default_random_engine
     auto localBestCost = bestCost;
     
     auto iterationsSinceNewBest = 0u;
+    // Stopping rules, checked at the end of every segment. Their count of
+    // iterations without a new best is not reset by escapes, unlike iterationsSinceNewBest.
+    StopRules stopRules{p, config, budget};
+    std::optional<StopReason> stop;
+    Archipelago* const archipelago = cooperation != nullptr ? cooperation->archipelago : nullptr;
+    SharedBest* const sharedBest = cooperation != nullptr ? cooperation->sharedBest : nullptr;
+    // Island model bookkeeping
+    auto iterationsSinceMigration = 0u;
+    bool bNewBestSinceMigration{false};
 
     // Temperature is here the same as percentage for acceptance. Initial temperature is 0.99.
     double temperature = 0.70;
@@ -479,7 +697,7 @@ SolutionCached adaptiveCachedSearch(const Problem& p, std::default_random_engine
     double coolingFactor = std::exp(std::log(0.01 / temperature) / MAX_SEARCH);
 
     const auto rand = [&](){
-        return ran() % 1000000 * 0.000001;
+        return randomUnit(ran);
     };
 
     // Note: Annoying that c++ doesnt have const reference captures
@@ -505,21 +723,98 @@ SolutionCached adaptiveCachedSearch(const Problem& p, std::default_random_engine
         return cost < localBestCost /*|| rand() < temperature*/;
     };
 
+    // Everything else to do once best has been replaced
+    const auto onNewBest = [&]() {
+        stopRules.improved();
+        if (budget != nullptr)
+            budget->improved();
+        if (observer != nullptr)
+            (*observer)(best, bestCost);
+    };
+
+    // Checkpointing. Saved at the end of a segment, where scores have just been reset.
+    unsigned int firstIteration{0};
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    const auto saveCheckpoint = [&](bool bFinished, unsigned int iteration) {
+        SearchState state;
+        state.bFinished = bFinished;
+        state.iteration = iteration;
+        state.iterationsSinceNewBest = iterationsSinceNewBest;
+        state.iterationsSinceMigration = iterationsSinceMigration;
+        state.iterationsSinceImprovement = stopRules.iterationsSinceImprovement;
+        state.sinceImprovement = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stopRules.lastImprovement);
+        state.bNewBestSinceMigration = bNewBestSinceMigration;
+        state.temperature = temperature;
+        if (budget != nullptr) {
+            state.elapsed = budget->elapsed();
+            state.improvedAt = budget->improvedAt();
+        }
+        state.weights = weights;
+        state.ran = ran;
+        state.streams = streams;
+        state.best = best;
+        state.bestCost = bestCost;
+        state.localBest = localBest;
+        state.localBestCost = localBestCost;
+        if (const auto err = saveSearchState(checkpoint->path, state))
+            std::cout << err->what() << std::endl;
+        lastCheckpoint = std::chrono::steady_clock::now();
+    };
+
+    if (checkpoint != nullptr && checkpoint->bResume && std::filesystem::exists(checkpoint->path)) {
+        const auto result = loadSearchState(checkpoint->path, p);
+        if (!result)
+            throw result.err();
+        auto state = result.val();
+        if (state.weights.size() != weights.size() || state.streams.size() != streams.size())
+            throw std::runtime_error{"Checkpoint " + checkpoint->path.string() + " was saved with other operators or speculation"};
+        if (state.bFinished) {
+            if (p_stopReason != nullptr)
+                *p_stopReason = StopReason::Resumed;
+            return state.best;
+        }
+
+        firstIteration = state.iteration;
+        iterationsSinceNewBest = state.iterationsSinceNewBest;
+        iterationsSinceMigration = state.iterationsSinceMigration;
+        stopRules.iterationsSinceImprovement = state.iterationsSinceImprovement;
+        stopRules.lastImprovement = std::chrono::steady_clock::now() - state.sinceImprovement;
+        bNewBestSinceMigration = state.bNewBestSinceMigration;
+        temperature = state.temperature;
+        weights = std::move(state.weights);
+        // Operators hold on to the engines, so assign in place
+        ran = state.ran;
+        for (std::size_t k{0}; k < streams.size(); ++k)
+            streams[k] = state.streams[k];
+        best = std::move(state.best);
+        bestCost = state.bestCost;
+        localBest = std::move(state.localBest);
+        localBestCost = state.localBestCost;
+        // Fill in the cost caches, as they were when saved
+        getFeasibleCost(p, best);
+        getFeasibleCost(p, localBest);
+        if (budget != nullptr)
+            budget->resume(state.elapsed, state.improvedAt);
+    }
+
 #ifdef RUN_FOR_10_MINUTES
-    auto remainingTime = p_start != nullptr ? (availableTime - std::chrono::duration_cast<TimeUnit>(std::chrono::high_resolution_clock::now() - *p_start).count()) : -1;
-    long long elapsed;
-    std::chrono::high_resolution_clock::time_point start;
+    // Keep searching in blocks until the budget runs out or the search converges
     do {
-        start = std::chrono::high_resolution_clock::now();
 #endif
 
-        for (unsigned int i{0}; i < MAX_SEARCH;) {
-            std::array<std::pair<unsigned int, unsigned int>, weights.size()> scores{};
-            // Just to be safe:
-            for (auto& score : scores) score = {0u, 0u};
+        for (unsigned int i{firstIteration}; i < MAX_SEARCH;) {
+            auto& scores = scratch.scores;
+            scores.assign(weights.size(), {0u, 0u});
 
-            for (unsigned int j{0}; j < SEGMENT_SIZE; ++i, ++j, ++iterationsSinceNewBest, temperature *= coolingFactor) {
-                if (ESCAPE_CONDITION < iterationsSinceNewBest) {
+            for (unsigned int j{0}; j < SEGMENT_SIZE; ++i, ++j, ++iterationsSinceNewBest, ++stopRules.iterationsSinceImprovement, temperature *= coolingFactor) {
+                const auto* global = ESCAPE_CONDITION < iterationsSinceNewBest && sharedBest != nullptr ? sharedBest->better(bestCost) : nullptr;
+                if (global != nullptr) {
+                    // Another search is doing better, so restart from the global best instead of escaping
+                    localBest = best = global->solution;
+                    localBestCost = bestCost = global->cost;
+                    iterationsSinceNewBest = 0;
+                    onNewBest();
+                } else if (ESCAPE_CONDITION < iterationsSinceNewBest) {
                     // Apply escape algorithm (something to bring us out of local optima)
                     localBest = op::backinsert(p, localBest, ran);
                     // auto newSol = genRandSolutionCached(p, ran);
@@ -539,18 +834,49 @@ SolutionCached adaptiveCachedSearch(const Problem& p, std::default_random_engine
                     iterationsSinceNewBest = 0;
                 }
 
-                const auto r = rand();
-                const auto opIndex = selectOperatorIndex(r);
-                const auto& op = operators[opIndex];
-                // t1 = Clock::now();
-                auto current = op(localBest);
-                // t2 = Clock::now();
+                std::size_t opIndex;
+                SolutionCached current;
+                if (SPECULATION < 2) {
+                    const auto r = rand();
+                    opIndex = selectOperatorIndex(r);
+                    const auto& op = operators[opIndex];
+                    // t1 = Clock::now();
+                    current = op(localBest);
+                    // t2 = Clock::now();
+                } else {
+                    // Generate every candidate from the incumbent at once, and continue with one of them
+                    randomUnits(ran, candidatePicks);
+                    for (std::size_t k{0}; k < SPECULATION; ++k)
+                        candidateOperators[k] = selectOperatorIndex(candidatePicks[k]);
+                    const auto generate = [&](std::size_t k) {
+                        candidates[k] = streamOperators[k][candidateOperators[k]](localBest);
+                        const auto cost = getFeasibleCost(p, candidates[k]);
+                        candidateCosts[k] = cost ? cost.val() : std::numeric_limits<int>::max();
+                    };
+                    if (pool != nullptr)
+                        pool->parallelFor(SPECULATION, generate);
+                    else
+                        for (std::size_t k{0}; k < SPECULATION; ++k)
+                            generate(k);
+
+                    auto chosen = static_cast<std::size_t>(std::min_element(candidateCosts.begin(), candidateCosts.end()) - candidateCosts.begin());
+                    if (config.speculationAccept == SpeculationAccept::First)
+                        if (const auto first = std::find_if(candidateCosts.begin(), candidateCosts.end(), [&](const auto& c){ return accept(c); }); first != candidateCosts.end())
+                            chosen = static_cast<std::size_t>(first - candidateCosts.begin());
+
+                    // The other candidates still count towards their operators' scores
+                    for (std::size_t k{0}; k < SPECULATION; ++k)
+                        if (k != chosen)
+                            scores[candidateOperators[k]] += std::make_pair(candidateCosts[k] != std::numeric_limits<int>::max() ? 1u : 0u, 1u);
+                    opIndex = candidateOperators[chosen];
+                    current = std::move(candidates[chosen]);
+                }
                 unsigned int score = 0;
 
                 const auto result = getFeasibleCost(p, current);
                 if (result) {
                     score += 1; // Get 1 score from finding a feasible solution
-                    const auto cost = result.val_or_max();
+                    auto cost = result.val_or_max();
                     // if (cost < localBestCost) {
                     //     score += 1;
                     //     localBestCost = cost;
@@ -564,9 +890,16 @@ SolutionCached adaptiveCachedSearch(const Problem& p, std::default_random_engine
                     // }
                     if (cost < bestCost) {
                         score += 20;
+                        // Intensify by ordering the routes that changed since the last best optimally
+                        current = op::resequence(p, std::move(current), best);
+                        cost = getFeasibleCost(p, current).val_or_max();
                         localBest = best = current;
                         localBestCost = bestCost = cost;
                         iterationsSinceNewBest = 0;
+                        bNewBestSinceMigration = true;
+                        onNewBest();
+                        if (sharedBest != nullptr)
+                            sharedBest->publish(best, bestCost);
                     }
 
                     // Acceptance criteria:
@@ -583,7 +916,8 @@ SolutionCached adaptiveCachedSearch(const Problem& p, std::default_random_engine
             }
 
             // After each segment, adjust the weights to next segment using scores from last segment and control r
-            std::array<float, weights.size()> normalizedScores;
+            auto& normalizedScores = scratch.normalizedScores;
+            normalizedScores.assign(weights.size(), 0.f);
             // Normalize according to count
             for (auto j{0u}; j < weights.size(); ++j) {
                 const auto& [score, count] = scores[j];
@@ -614,18 +948,474 @@ SolutionCached adaptiveCachedSearch(const Problem& p, std::default_random_engine
             if (std::any_of(weights.begin(), weights.end(), [](const auto& w){ return std::isnan(w); }))
                 throw std::runtime_error{"Weights are NaN!"};
 #endif
+
+            // Island model: share the best solution with the neighbours, and continue from a received one if it's better
+            if (archipelago != nullptr && cooperation->migrationInterval <= (iterationsSinceMigration += SEGMENT_SIZE)) {
+                iterationsSinceMigration = 0;
+                if (bNewBestSinceMigration) {
+                    archipelago->emigrate(cooperation->island, best, bestCost, ran);
+                    bNewBestSinceMigration = false;
+                }
+                if (auto migrant = archipelago->immigrate(cooperation->island); migrant && migrant->cost < localBestCost) {
+                    localBest = std::move(migrant->solution);
+                    localBestCost = migrant->cost;
+                    if (localBestCost < bestCost) {
+                        best = localBest;
+                        bestCost = localBestCost;
+                        iterationsSinceNewBest = 0;
+                        onNewBest();
+                    }
+                }
+            }
+
+            if (checkpoint != nullptr && checkpoint->interval <= std::chrono::steady_clock::now() - lastCheckpoint)
+                saveCheckpoint(false, i);
+
+            if ((stop = stopRules.check(bestCost)))
+                break;
         }
+        firstIteration = 0;
 
 #ifdef RUN_FOR_10_MINUTES
-        elapsed = std::chrono::duration_cast<TimeUnit>(std::chrono::high_resolution_clock::now() - start).count();
-        remainingTime -= elapsed;
-    } while (elapsed < remainingTime);
-
+    } while (!stop && budget != nullptr);
 #endif
+    if (p_stopReason != nullptr)
+        *p_stopReason = stop.value_or(StopReason::Iterations);
 
     // std::cout << "Operator efficiency:" << std::endl;
     // for (int i{0}; i < operatorEfficiency.size(); ++i)
     //     std::cout << i << ": " << static_cast<double>(operatorEfficiency[i].first) / operatorEfficiency[i].second << std::endl;
 
+    if (checkpoint != nullptr)
+        saveCheckpoint(true, MAX_SEARCH);
+
+    return best;
+}
+SolutionCached tabuSearch(const Problem& p, Random& ran, TimeBudget::Run* budget, ThreadPool* pool, const SearchConfig* p_config, const Cooperation* cooperation, const Checkpoint*, const ImprovementObserver* observer, SearchScratch*, StopReason* p_stopReason) {
+    static const SearchConfig defaultConfig{};
+    const auto& config = p_config != nullptr ? *p_config : defaultConfig;
+
+    constexpr unsigned int MAX_SEARCH = 100000;
+    const unsigned int SEGMENT_SIZE = std::max(config.segmentSize, 1u);
+    const unsigned int ESCAPE_CONDITION = config.escapeCondition;
+    const auto callCount = static_cast<index_t>(p.calls.size());
+    const auto vCount = static_cast<index_t>(p.vehicles.size());
+    const unsigned int TENURE = config.tabuTenure != 0 ? config.tabuTenure : 5u + callCount / 4u;
+    SharedBest* const sharedBest = cooperation != nullptr ? cooperation->sharedBest : nullptr;
+
+    // Moving a call into a vehicle is tabu for a while after it left that vehicle
+    TabuList tabu{TENURE * 2};
+    const auto attribute = [&](index_t call, index_t vehicle) { return static_cast<std::uint32_t>(call) * (vCount + 1u) + vehicle; };
+
+    auto current = genInitialSolutionCached(p);
+    const auto initialCost = getFeasibleCost(p, current);
+    auto currentCost = initialCost ? initialCost.val() : std::numeric_limits<int>::max();
+    auto best = current;
+    auto bestCost = currentCost;
+
+    Relocations relocations{p};
+    relocations.reset(current, pool);
+
+    StopRules stopRules{p, config, budget};
+    std::optional<StopReason> stop;
+    auto iterationsSinceNewBest = 0u;
+
+    for (std::uint32_t iteration{1}; !stop; ++iteration) {
+        // Aspiration: a tabu move is still allowed if it leads to a new best
+        const auto move = relocations.best([&](index_t call, index_t to, int delta) {
+            return currentCost + delta < bestCost || !tabu.tabu(attribute(call, to), iteration);
+        }, ran);
+
+        if (move) {
+            const auto from = relocations.apply(*move, pool);
+            currentCost += move->delta;
+            // Random tenure, so the search doesn't fall into cycles of a fixed length
+            tabu.add(attribute(move->call, from), iteration, TENURE + randomIndex(ran, TENURE / 2 + 1));
+        }
+
+        if (currentCost < bestCost) {
+            best = current;
+            bestCost = currentCost;
+#ifndef NDEBUG
+            const auto check = getFeasibleCost(p, best);
+            if (!check || check.val() != bestCost)
+                throw std::logic_error{"Tabu search lost track of its cost"};
+#endif
+            iterationsSinceNewBest = 0;
+            stopRules.improved();
+            if (budget != nullptr)
+                budget->improved();
+            if (observer != nullptr)
+                (*observer)(best, bestCost);
+            if (sharedBest != nullptr)
+                sharedBest->publish(best, bestCost);
+        } else if (ESCAPE_CONDITION < ++iterationsSinceNewBest) {
+            // Restart from the best solution (or the global best, if better) with some random calls taken out
+            const auto* global = sharedBest != nullptr ? sharedBest->better(bestCost) : nullptr;
+            current = op::randomremoval(p, global != nullptr ? global->solution : best, std::max(2u, callCount / 10u), ran);
+            const auto cost = getFeasibleCost(p, current);
+            currentCost = cost ? cost.val() : std::numeric_limits<int>::max();
+            iterationsSinceNewBest = 0;
+            relocations.reset(current, pool);
+        }
+
+        ++stopRules.iterationsSinceImprovement;
+        if (iteration % SEGMENT_SIZE == 0) {
+            stop = stopRules.check(bestCost);
+            if (!stop && budget == nullptr && MAX_SEARCH <= iteration)
+                stop = StopReason::Iterations;
+        }
+    }
+
+    if (p_stopReason != nullptr)
+        *p_stopReason = *stop;
     return best;
-}
\ No newline at end of file
+}
+
+SolutionCached memeticSearch(const Problem& p, Random& ran, TimeBudget::Run* budget, ThreadPool* pool, const SearchConfig* p_config, const Cooperation* cooperation, const Checkpoint*, const ImprovementObserver* observer, SearchScratch*, StopReason* p_stopReason) {
+    static const SearchConfig defaultConfig{};
+    const auto& config = p_config != nullptr ? *p_config : defaultConfig;
+
+    constexpr unsigned int MAX_GENERATIONS = 500;
+    constexpr std::size_t CLOSEST = 3;   // Neighbours counted in the diversity of an individual
+    const std::size_t MU = std::max(config.populationSize, 2u);
+    const std::size_t LAMBDA = std::max(config.offspring, 1u);
+    // Leaves room for at least one new individual when restarting
+    const std::size_t ELITE = std::clamp<std::size_t>(config.eliteCount, 1, MU - 1);
+    const std::size_t CAPACITY = MU + LAMBDA;
+    const unsigned int ESCAPE_CONDITION = config.escapeCondition;
+    const auto callCount = static_cast<index_t>(p.calls.size());
+    const auto vCount = static_cast<index_t>(p.vehicles.size());
+    SharedBest* const sharedBest = cooperation != nullptr ? cooperation->sharedBest : nullptr;
+
+    struct Individual {
+        SolutionCached solution;
+        int cost{std::numeric_limits<int>::max()};
+        double fitness{0.0};
+    };
+
+    // Everything an offspring is built with, one per offspring so they can be built in parallel
+    struct Workspace {
+        Relocations relocations;
+        Random ran;
+        std::vector<RouteSchedule> schedules;
+        std::vector<char> taken;     // [call] Whether the call is in one of the routes taken from the first parent
+        std::vector<char> fromFirst; // [vehicle] Whether the route is taken from the first parent
+        std::vector<index_t> order;
+    };
+
+    // The population lives in a fixed pool of slots, where copying a solution
+    // into a slot reuses the buffers of whatever was there before
+    std::vector<Individual> slots(CAPACITY, Individual{genInitialSolutionCached(p)});
+    std::vector<std::size_t> live, free(CAPACITY);
+    live.reserve(CAPACITY);
+    std::iota(free.rbegin(), free.rend(), std::size_t{0});
+    std::vector<float> distances(CAPACITY * CAPACITY, 0.f);
+
+    std::vector<Workspace> workspaces;
+    workspaces.reserve(std::max(MU, LAMBDA));
+    auto streams = ran;
+    for (std::size_t k{0}; k < std::max(MU, LAMBDA); ++k) {
+        streams.jump();
+        workspaces.push_back(Workspace{Relocations{p}, streams, std::vector<RouteSchedule>(vCount), std::vector<char>(callCount), std::vector<char>(vCount), std::vector<index_t>(callCount)});
+        std::iota(workspaces.back().order.begin(), workspaces.back().order.end(), index_t{0});
+    }
+
+    const auto evaluate = [&](Individual& individual) {
+        const auto cost = getFeasibleCost(p, individual.solution);
+        individual.cost = cost ? cost.val() : std::numeric_limits<int>::max();
+    };
+
+    // Relocation descent: applies the cheapest improving move until there are none
+    const auto educate = [&](Workspace& w, Individual& individual) {
+        w.relocations.reset(individual.solution);
+        while (const auto move = w.relocations.best([](index_t, index_t, int delta) { return delta < 0; }, w.ran))
+            w.relocations.apply(*move);
+        evaluate(individual);
+    };
+
+    // Greedy insertion of every call, in random order, where it is cheapest
+    const auto construct = [&](Workspace& w, Individual& individual) {
+        auto& s = individual.solution;
+        for (index_t v{0}; v < vCount; ++v) {
+            s[v].calls.clear();
+            s[v].bChanged = true;
+            buildSchedule(p, v, s[v].calls, w.schedules[v]);
+        }
+        s.back().calls.clear();
+        s.back().bChanged = true;
+        std::shuffle(w.order.begin(), w.order.end(), w.ran);
+        for (const auto c : w.order) {
+            const auto insertion = bestInsertion(p, w.schedules, c);
+            if (insertion && insertion->delta < p.calls[c].costOfNotTransporting) {
+                applyInsertion(s[insertion->vehicle].calls, *insertion);
+                buildSchedule(p, insertion->vehicle, s[insertion->vehicle].calls, w.schedules[insertion->vehicle]);
+            } else {
+                s.back().calls.push_back(c);
+                s.back().calls.push_back(c);
+            }
+        }
+        s.index.clear();
+        educate(w, individual);
+    };
+
+    /* Route based crossover: the routes of a random half of the vehicles are
+     * taken as they are from a, the rest from b without the calls already
+     * taken. Routes kept whole keep their cached costs. Calls that are in
+     * neither go to the dummy, for education to insert again.
+     */
+    const auto crossover = [&](Workspace& w, const Individual& a, const Individual& b, Individual& child) {
+        auto& s = child.solution;
+        s = b.solution;
+        std::fill(w.taken.begin(), w.taken.end(), char{0});
+        for (index_t v{0}; v < vCount; ++v) {
+            w.fromFirst[v] = randomIndex(w.ran, 2) == 0;
+            if (!w.fromFirst[v])
+                continue;
+            s[v] = a.solution[v];
+            for (const auto c : s[v].calls)
+                w.taken[c] = 1;
+        }
+
+        for (index_t v{0}; v <= vCount; ++v) {
+            if (v < vCount && w.fromFirst[v])
+                continue;
+            auto& route = s[v].calls;
+            const auto size = route.size();
+            erase_if(route, [&](index_t c) { return w.taken[c] != 0; });
+            if (v == vCount || route.size() == size)
+                continue;
+            buildSchedule(p, v, route, w.schedules[v]);
+            if (feasible(p, v, w.schedules[v].route())) {
+                s[v].cost = w.schedules[v].route().cost;
+                s[v].bChanged = false;
+            } else {
+                // Rare, as taking calls out of a route seldom makes it infeasible
+                for (const auto c : route)
+                    s.back().calls.push_back(c);
+                route.clear();
+                s[v].bChanged = true;
+            }
+        }
+        // Calls of b's vehicles that were replaced by a's
+        for (index_t c{0}; c < callCount; ++c) {
+            const auto v = b.solution.index.vehicleOf(c);
+            if (w.taken[c] == 0 && v < vCount && w.fromFirst[v]) {
+                s.back().calls.push_back(c);
+                s.back().calls.push_back(c);
+            }
+        }
+        s.back().bChanged = true;
+        s.index.clear();
+    };
+
+    const auto distance = [&](std::size_t i, std::size_t j) { return distances[i * CAPACITY + j]; };
+    const auto measure = [&](std::size_t i) {
+        const auto& a = slots[i].solution.index;
+        for (const auto j : live) {
+            const auto& b = slots[j].solution.index;
+            index_t differences{0};
+            for (index_t c{0}; c < callCount; ++c)
+                differences += a.vehicleOf(c) != b.vehicleOf(c);
+            distances[i * CAPACITY + j] = distances[j * CAPACITY + i] = callCount != 0 ? static_cast<float>(differences) / callCount : 0.f;
+        }
+    };
+    const auto add = [&](std::size_t i) {
+        measure(i);
+        live.push_back(i);
+    };
+
+    // Biased fitness from Vidal et al.: rank by cost plus rank by diversity,
+    // weighted so that the elite individuals always survive. Lower is better.
+    std::vector<std::size_t> byCost(CAPACITY), byDiversity(CAPACITY);
+    std::vector<float> diversity(CAPACITY), closest(CAPACITY);
+    const auto updateFitness = [&]() {
+        const auto n = live.size();
+        if (n < 2) {
+            for (const auto i : live)
+                slots[i].fitness = 0.0;
+            return;
+        }
+        const auto neighbours = std::min(CLOSEST, n - 1);
+        for (const auto i : live) {
+            closest.clear();
+            for (const auto j : live)
+                if (j != i)
+                    closest.push_back(distance(i, j));
+            std::partial_sort(closest.begin(), closest.begin() + neighbours, closest.end());
+            diversity[i] = std::accumulate(closest.begin(), closest.begin() + neighbours, 0.f) / neighbours;
+        }
+        byCost.assign(live.begin(), live.end());
+        std::sort(byCost.begin(), byCost.end(), [&](auto i, auto j) { return std::tie(slots[i].cost, i) < std::tie(slots[j].cost, j); });
+        byDiversity.assign(live.begin(), live.end());
+        std::sort(byDiversity.begin(), byDiversity.end(), [&](auto i, auto j) { return diversity[j] < diversity[i] || (diversity[i] == diversity[j] && i < j); });
+        const auto diversityWeight = 1.0 - static_cast<double>(ELITE) / n;
+        for (std::size_t r{0}; r < n; ++r)
+            slots[byCost[r]].fitness = static_cast<double>(r) / (n - 1);
+        for (std::size_t r{0}; r < n; ++r)
+            slots[byDiversity[r]].fitness += diversityWeight * r / (n - 1);
+    };
+
+    // Removes the worst individuals until mu are left, clones first
+    const auto selectSurvivors = [&]() {
+        while (MU < live.size()) {
+            updateFitness();
+            const auto worse = [&](std::size_t i, std::size_t j) { return slots[i].fitness < slots[j].fitness; };
+            auto worst = live.end();
+            for (auto it = live.begin(); it != live.end(); ++it) {
+                const auto clone = std::any_of(live.begin(), live.end(), [&](auto j) { return j != *it && distance(*it, j) == 0.f && slots[j].cost == slots[*it].cost; });
+                if (clone && (worst == live.end() || worse(*worst, *it)))
+                    worst = it;
+            }
+            if (worst == live.end())
+                worst = std::max_element(live.begin(), live.end(), worse);
+            free.push_back(*worst);
+            live.erase(worst);
+        }
+        updateFitness();
+    };
+
+    const auto tournament = [&]() {
+        const auto a = live[randomIndex(ran, live.size())];
+        const auto b = live[randomIndex(ran, live.size())];
+        return slots[a].fitness <= slots[b].fitness ? a : b;
+    };
+
+    // Fills the population up to mu with new individuals
+    const auto populate = [&]() {
+        const auto count = live.size() < MU ? MU - live.size() : 0;
+        std::span<const std::size_t> fresh{free.data() + free.size() - count, count};
+        const auto build = [&](std::size_t k) { construct(workspaces[k], slots[fresh[k]]); };
+        if (pool != nullptr)
+            pool->parallelFor(count, build);
+        else
+            for (std::size_t k{0}; k < count; ++k)
+                build(k);
+        for (const auto i : fresh)
+            add(i);
+        free.resize(free.size() - count);
+        updateFitness();
+    };
+
+    auto best = genInitialSolutionCached(p);
+    const auto initialCost = getFeasibleCost(p, best);
+    auto bestCost = initialCost ? initialCost.val() : std::numeric_limits<int>::max();
+
+    StopRules stopRules{p, config, budget};
+    std::optional<StopReason> stop;
+    auto offspringSinceNewBest = 0u;
+
+    const auto consider = [&](Individual& individual) {
+        if (bestCost <= individual.cost)
+            return;
+        // Intensify on the routes that changed since the previous best
+        best = op::resequence(p, individual.solution, best);
+        const auto cost = getFeasibleCost(p, best);
+        bestCost = cost ? cost.val() : individual.cost;
+        individual.solution = best;
+        individual.cost = bestCost;
+#ifndef NDEBUG
+        auto check = best;
+        for (auto& v : check)
+            v.bChanged = true;
+        const auto checkCost = getFeasibleCost(p, check);
+        if (!checkCost || checkCost.val() != bestCost)
+            throw std::logic_error{"Memetic search lost track of its cost"};
+#endif
+        offspringSinceNewBest = 0;
+        stopRules.improved();
+        if (budget != nullptr)
+            budget->improved();
+        if (observer != nullptr)
+            (*observer)(best, bestCost);
+        if (sharedBest != nullptr)
+            sharedBest->publish(best, bestCost);
+    };
+
+    populate();
+    for (const auto i : live)
+        consider(slots[i]);
+
+    std::vector<std::pair<std::size_t, std::size_t>> parents(LAMBDA);
+    for (unsigned int generation{1}; !stop; ++generation) {
+        // Parents are picked up front from the search's own stream, so the result doesn't depend on threading
+        for (auto& [a, b] : parents)
+            a = tournament(), b = tournament();
+
+        std::span<const std::size_t> children{free.data() + free.size() - LAMBDA, LAMBDA};
+        const auto breed = [&](std::size_t k) {
+            auto& w = workspaces[k];
+            auto& child = slots[children[k]];
+            crossover(w, slots[parents[k].first], slots[parents[k].second], child);
+            educate(w, child);
+        };
+        if (pool != nullptr)
+            pool->parallelFor(LAMBDA, breed);
+        else
+            for (std::size_t k{0}; k < LAMBDA; ++k)
+                breed(k);
+
+        for (const auto i : children) {
+            consider(slots[i]);
+            add(i);
+        }
+        free.resize(free.size() - LAMBDA);
+        selectSurvivors();
+
+        stopRules.iterationsSinceImprovement += LAMBDA;
+        offspringSinceNewBest += LAMBDA;
+        if (ESCAPE_CONDITION < offspringSinceNewBest) {
+            // Keep the elite and replace everyone else, with the global best if it is better
+            std::sort(live.begin(), live.end(), [&](auto i, auto j) { return std::tie(slots[i].cost, i) < std::tie(slots[j].cost, j); });
+            free.insert(free.end(), live.begin() + ELITE, live.end());
+            live.resize(ELITE);
+            if (const auto* global = sharedBest != nullptr ? sharedBest->better(bestCost) : nullptr) {
+                // Takes the place of the worst kept individual if there is no room left
+                std::size_t i;
+                if (live.size() < MU) {
+                    i = free.back();
+                    free.pop_back();
+                } else {
+                    i = live.back();
+                    live.pop_back();
+                }
+                auto& individual = slots[i];
+                individual.solution = global->solution;
+                individual.solution.index.clear();
+                callIndex(individual.solution);
+                individual.cost = global->cost;
+                add(i);
+            }
+            populate();
+            for (const auto i : live)
+                consider(slots[i]);
+            offspringSinceNewBest = 0;
+        }
+
+        stop = stopRules.check(bestCost);
+        if (!stop && budget == nullptr && MAX_GENERATIONS <= generation)
+            stop = StopReason::Iterations;
+    }
+
+    if (p_stopReason != nullptr)
+        *p_stopReason = *stop;
+    return best;
+}
+
+SolutionCached exactSearch(const Problem& p, Random&, TimeBudget::Run* budget, ThreadPool*, const SearchConfig* p_config, const Cooperation* cooperation, const Checkpoint*, const ImprovementObserver* observer, SearchScratch*, StopReason* p_stopReason) {
+    static const SearchConfig defaultConfig{};
+    const auto& config = p_config != nullptr ? *p_config : defaultConfig;
+    SharedBest* const sharedBest = cooperation != nullptr ? cooperation->sharedBest : nullptr;
+
+    auto result = branchAndBound(p, nullptr, config.exactNodes);
+    if (budget != nullptr)
+        budget->improved();
+    if (observer != nullptr)
+        (*observer)(result.solution, result.cost);
+    if (sharedBest != nullptr)
+        sharedBest->publish(result.solution, result.cost);
+
+    if (p_stopReason != nullptr)
+        *p_stopReason = result.bOptimal ? StopReason::Optimal : StopReason::Iterations;
+    return std::move(result.solution);
+}
@@ -1,26 +1,126 @@
 #pragma once
 #include "problem.h"
-#include <random>
+#include "budget.h"
+#include "random.h"
 #include <chrono>
+#include <functional>
+#include <string_view>
+
+class ThreadPool;
+struct SearchConfig;
+struct Cooperation;
+struct Checkpoint;
 
 // Solution generation
 Solution genInitialSolution(const Problem& p);
 SolutionCached genInitialSolutionCached(const Problem& p);
-Solution genRandSolution(const Problem& p);
-Solution genRandSolution(const Problem& p, std::default_random_engine& engine);
-SolutionCached genRandSolutionCached(const Problem& p, std::default_random_engine& engine);
+Solution genRandSolution(const Problem& p, Random& engine);
+SolutionCached genRandSolutionCached(const Problem& p, Random& engine);
 
 // Searches
-Solution blindRandomSearch(const Problem& p, std::default_random_engine& ran);
-Solution localSearch(const Problem& p, std::default_random_engine& ran);
-Solution simulatedAnnealing(const Problem& p, std::default_random_engine& ran);
-Solution simulatedAnnealing2ElectricBoogaloo(const Problem& p, std::default_random_engine& ran);
-Solution adaptiveSearch(const Problem& p);
-Solution adaptiveSearch(const Problem& p, std::default_random_engine& engine);
-SolutionCached adaptiveCachedSearch(const Problem& p, std::default_random_engine& engine, const std::chrono::high_resolution_clock::time_point* p_start = nullptr, long long availableTime = -1);
-
-using HeuristicParallelSignature = Solution (*)(const Problem&, std::default_random_engine&);
-using HeuristicParallelSignatureCached = SolutionCached (*)(const Problem&, std::default_random_engine&, const std::chrono::high_resolution_clock::time_point*, long long);
-using HeuristicSimpleSignature = Solution (*)(const Problem&);
+Solution blindRandomSearch(const Problem& p, Random& ran);
+Solution localSearch(const Problem& p, Random& ran);
+Solution simulatedAnnealing(const Problem& p, Random& ran);
+Solution simulatedAnnealing2ElectricBoogaloo(const Problem& p, Random& ran);
+Solution adaptiveSearch(const Problem& p, Random& engine);
+/// Called by a search with every new best solution it finds, from the search's thread
+using ImprovementObserver = std::function<void(const SolutionCached& best, int cost)>;
+
+/**
+ * @brief Working memory of adaptiveCachedSearch
+ * Whoever runs many searches one after another can keep it between them,
+ * so the buffers are only grown once instead of on every search.
+ */
+struct SearchScratch {
+    std::vector<std::pair<unsigned int, unsigned int>> scores;
+    std::vector<float> normalizedScores;
+    std::vector<double> candidatePicks;
+    std::vector<std::size_t> candidateOperators;
+    std::vector<SolutionCached> candidates;
+    std::vector<int> candidateCosts;
+};
+
+/// Why a search stopped
+enum class StopReason {
+    Iterations,         // Searched every iteration of its block
+    TimeBudget,         // Used up its time
+    Converged,          // The time budget found it converged
+    StallTime,          // stall_seconds without a new best
+    StallIterations,    // stall_iterations without a new best
+    TargetCost,         // Reached target_cost
+    TargetGap,          // Got within target_gap of the lower bound
+    Resumed,            // Had already finished when resumed from a checkpoint
+    Optimal             // Proved that its best solution is optimal
+};
+
+std::string_view describe(StopReason reason);
+
+/**
+ * @param budget Time of this run when running for 10 minutes. The search keeps
+ * going until the budget says the run has expired, and reports every new best
+ * solution to it. Searches a single block of iterations if nullptr.
+ * @param pool Optional thread pool shared between searches, used to evaluate
+ * insertions for every vehicle in parallel. Results are the same as without.
+ * @param config Operators, weights and parameters to use. Defaults if nullptr.
+ * @param cooperation How to work together with other searches of the same instance.
+ * With an archipelago the search periodically sends its best solution to the
+ * neighbouring islands and continues from a received one if it is better.
+ * With a shared best it publishes every new best solution, and restarts from the
+ * global best instead of escaping when that is better than its own.
+ * @param checkpoint Where to save the state of the search every now and then,
+ * and whether to continue from a previously saved state. A finished search
+ * leaves its final state, so resuming it just returns its best solution.
+ * @param observer Told about every new best solution while the search is running.
+ * Should be quick, as the search waits for it.
+ * @param scratch Working memory to use instead of allocating its own. One search at a time.
+ * @param stopReason Set to the reason the search stopped, if given.
+ */
+SolutionCached adaptiveCachedSearch(const Problem& p, Random& engine, TimeBudget::Run* budget = nullptr, ThreadPool* pool = nullptr, const SearchConfig* config = nullptr, const Cooperation* cooperation = nullptr, const Checkpoint* checkpoint = nullptr, const ImprovementObserver* observer = nullptr, SearchScratch* scratch = nullptr, StopReason* stopReason = nullptr);
+
+/**
+ * @brief Tabu search over relocations of single calls
+ * Every iteration moves the call to the vehicle (or the dummy) that gives the
+ * cheapest solution, at its cheapest position there, even if that is worse
+ * than the current solution. A call that leaves a vehicle can't move back into
+ * it for a random number of iterations around tabu_tenure, unless that gives a
+ * new best. Moves are evaluated incrementally, so an iteration only
+ * reevaluates the two vehicles the last move changed. After escape_condition
+ * iterations without a new best it restarts from the best solution with some
+ * calls taken out.
+ * Takes the same arguments as adaptiveCachedSearch. The pool is used to
+ * reevaluate vehicles in parallel. With cooperation it only takes part in
+ * the shared best. Checkpoints and scratch memory are not supported and are ignored.
+ */
+SolutionCached tabuSearch(const Problem& p, Random& engine, TimeBudget::Run* budget = nullptr, ThreadPool* pool = nullptr, const SearchConfig* config = nullptr, const Cooperation* cooperation = nullptr, const Checkpoint* checkpoint = nullptr, const ImprovementObserver* observer = nullptr, SearchScratch* scratch = nullptr, StopReason* stopReason = nullptr);
+
+/**
+ * @brief Memetic search with a population managed for diversity
+ * Hybrid genetic search after Vidal et al. (2013). Offspring are made by route
+ * based crossover, taking the routes of a random half of the vehicles from
+ * one parent and the rest from the other, and are educated by relocating
+ * single calls as long as that improves them. Individuals are ranked by a
+ * fitness that weighs their cost against how different they are from their
+ * closest neighbours, and the worst are removed (clones first) once the
+ * population grows past population_size. After escape_condition offspring
+ * without a new best, everyone but the elite is replaced by new individuals.
+ * Takes the same arguments as adaptiveCachedSearch. The pool is used to breed
+ * and educate the offspring of a generation in parallel. With cooperation it
+ * only takes part in the shared best. Checkpoints and scratch memory are not
+ * supported and are ignored.
+ */
+SolutionCached memeticSearch(const Problem& p, Random& engine, TimeBudget::Run* budget = nullptr, ThreadPool* pool = nullptr, const SearchConfig* config = nullptr, const Cooperation* cooperation = nullptr, const Checkpoint* checkpoint = nullptr, const ImprovementObserver* observer = nullptr, SearchScratch* scratch = nullptr, StopReason* stopReason = nullptr);
+
+/**
+ * @brief Exact branch and bound, see branchAndBound
+ * Visits at most exact_nodes nodes, and stops with StopReason::Optimal if it
+ * proved its solution optimal within them. Takes the same arguments as
+ * adaptiveCachedSearch, but only uses the config, the observer (told about the
+ * final solution) and the shared best. It doesn't watch the time budget, so it
+ * is only meant for small instances.
+ */
+SolutionCached exactSearch(const Problem& p, Random& engine, TimeBudget::Run* budget = nullptr, ThreadPool* pool = nullptr, const SearchConfig* config = nullptr, const Cooperation* cooperation = nullptr, const Checkpoint* checkpoint = nullptr, const ImprovementObserver* observer = nullptr, SearchScratch* scratch = nullptr, StopReason* stopReason = nullptr);
+
+using HeuristicParallelSignature = Solution (*)(const Problem&, Random&);
+using HeuristicParallelSignatureCached = SolutionCached (*)(const Problem&, Random&, TimeBudget::Run*, ThreadPool*, const SearchConfig*, const Cooperation*, const Checkpoint*, const ImprovementObserver*, SearchScratch*, StopReason*);
 
 using TimeUnit = std::chrono::microseconds;
\ No newline at end of file
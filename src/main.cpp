@@ -5,17 +5,35 @@
 #include "cost.h"
 #include <chrono>
 #include "heuristics.h"
+#include "config.h"
+#include "cooperation.h"
+#include "budget.h"
+#include "checkpoint.h"
+#include "stream.h"
+#include "seed.h"
+#include "exact.h"
+#include <string_view>
+#include <algorithm>
+#include "threadpool.h"
+#ifdef PARALLEL_NEIGHBORHOOD
+#pragma message("PARALLEL_NEIGHBORHOOD is enabled")
+#endif
 #ifdef PARALLEL_EXECUTION
 #pragma message("PARALLEL_EXECUTION is enabled")
+#endif
 #include <thread>
 #include <mutex>
-#endif
+#include <memory>
 #include <future>
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <charconv>
+#include <tuple>
+#include <random>
 
 #ifdef FILE_OUTPUT
 #pragma message("Outputting to file is enabled")
-#include <fstream>
-#include <filesystem>
 #endif
 
 #ifdef RUN_FOR_10_MINUTES
@@ -47,7 +65,6 @@ auto findAvailableTime(auto n, auto i) {
 int main(int argc, char *argv[])
 {
     const auto program_start = std::chrono::high_resolution_clock::now();
-    std::cout << "Hello world!" << std::endl;
 
 #ifdef FILE_OUTPUT
     // Output file setup
@@ -64,6 +81,13 @@ int main(int argc, char *argv[])
     }
 #endif
 
+    // Runs of each instance
+#ifdef PARALLEL_EXECUTION
+    constexpr unsigned int RUN_COUNT = 10;
+#else
+    constexpr unsigned int RUN_COUNT = 1;
+#endif
+
     // Input files:
     std::vector<std::pair<const char*, long long>> files{
         {"./data/Call_7_Vehicle_3.txt", 0},
@@ -73,228 +97,454 @@ int main(int argc, char *argv[])
         {"./data/Call_130_Vehicle_40.txt", 0}
     };
 
-    // Possibility to run with argument paths aswell
-    // If that is the case, use them instead
-    if (1 < argc)
+    // Search settings:
+    //  --config <file>        Applies every setting in file
+    //  --set <key>=<value>    Applies a single setting (after any config file before it)
+    //  --operators            Lists registered operators and their parameters
+    //  --checkpoint <dir>     Saves the state of every run in dir every checkpoint_interval seconds
+    //  --resume <dir>         Same as --checkpoint, but continues every run from its state in dir
+    //  --stream <path>        Writes every new best solution of an instance to path as a JSON line (- for stdout)
+    //  --seed <n>             Seeds every run from n instead of a random seed, making runs repeatable
+    //  --search <name>        Search engine to run (adaptive, tabu, memetic or exact). Repeat to run several on every instance.
+    SearchConfig config{};
+    std::vector<const char*> argFiles;
+    std::filesystem::path checkpointDir;
+    bool bResume{false};
+    std::string streamPath;
+    std::optional<unsigned int> seedArg;
+    std::vector<std::string_view> searchNames;
+    for (int i{1}; i < argc; ++i)
     {
-        files.clear();
-        for (int i{1}; i < argc; ++i)
-            files.emplace_back(argv[i], 0);
+        const std::string_view arg{argv[i]};
+        if (arg == "--operators")
+        {
+            for (const auto& info : operatorRegistry())
+            {
+                std::cout << info.name << (info.bEnabled ? "" : " (disabled)") << ": " << info.description << std::endl;
+                for (const auto& [name, value] : info.params)
+                    std::cout << "    " << info.name << "." << name << " = " << value << std::endl;
+            }
+            return 0;
+        }
+        else if ((arg == "--config" || arg == "--set") && i + 1 < argc)
+        {
+            const std::string value{argv[++i]};
+            auto result = arg == "--config" ? loadConfig(value, config) : applyOption(config, value);
+            if (!result)
+            {
+                std::cout << result.err().what() << std::endl;
+                return 1;
+            }
+            config = result.val();
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            const std::string_view value{argv[++i]};
+            unsigned int seed{0};
+            const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), seed);
+            if (ec != std::errc{} || end != value.data() + value.size())
+            {
+                std::cout << "Invalid seed \"" << value << "\". Exiting." << std::endl;
+                return 1;
+            }
+            seedArg = seed;
+        }
+        else if (arg == "--search" && i + 1 < argc)
+            searchNames.push_back(argv[++i]);
+        else if (arg == "--stream" && i + 1 < argc)
+            streamPath = argv[++i];
+        else if ((arg == "--checkpoint" || arg == "--resume") && i + 1 < argc)
+        {
+            checkpointDir = argv[++i];
+            bResume = arg == "--resume";
+        }
+        else
+            argFiles.push_back(argv[i]);
     }
 
-#ifdef RUN_FOR_10_MINUTES
-    // Calculate available time for each instance. (max milliseconds for each instance, floored)
-    constexpr long long MAX_SECONDS = 9 * 60;
-    constexpr auto MAX_TIME = std::chrono::duration_cast<TimeUnit>(std::chrono::seconds{MAX_SECONDS}).count();
-    for (int i{0}; i < files.size(); ++i)
-        files[i].second = findAvailableTime<MAX_TIME, 3>(files.size(), i);
-#endif
+    // Streaming to standard output keeps it to JSON lines only, so everything else goes to standard error
+    std::ostream standardOutput{std::cout.rdbuf()};
+    if (streamPath == "-")
+        std::cout.rdbuf(std::cerr.rdbuf());
+    std::cout << "Hello world!" << std::endl;
 
-    for (const auto [file, availableTime] : files)
+    if (std::none_of(config.operators.begin(), config.operators.end(), [](const auto& o){ return o.bEnabled && 0.f < o.weight; }))
     {
-        std::cout << std::endl << file << std::endl;
-        const bool bLastFile = file == files.back().first;
+        std::cout << "No operators enabled. Exiting." << std::endl;
+        return 1;
+    }
 
-#ifdef FILE_OUTPUT
-        // If file output is enabled, write some file handle info at the top
-        outf << std::filesystem::path{file}.filename().string() << std::endl;
+    // Every run gets its own random stream derived from this seed and the
+    // run's (instance, algorithm, run) ids, so given the same seed a run
+    // repeats exactly, no matter which thread or in which order it runs.
+    const auto seed = seedArg ? *seedArg : std::random_device{}();
+    std::cout << "Seed: " << seed << std::endl;
+
+    if (!checkpointDir.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(checkpointDir, ec);
+        if (ec)
+        {
+            std::cout << "Failed to create checkpoint directory " << checkpointDir << ": " << ec.message() << std::endl;
+            return 1;
+        }
+    }
+
+    // Anytime output of new best solutions, written from a thread of its own
+    std::ofstream streamFile;
+    std::unique_ptr<SolutionStream> stream;
+    if (!streamPath.empty())
+    {
+        if (streamPath != "-")
+        {
+            streamFile.open(streamPath, std::ofstream::trunc | std::ofstream::out);
+            if (!streamFile)
+            {
+                std::cout << "Failed to open stream output \"" << streamPath << "\". Exiting." << std::endl;
+                return 1;
+            }
+        }
+        stream = std::make_unique<SolutionStream>(streamPath != "-" ? static_cast<std::ostream&>(streamFile) : standardOutput, std::chrono::steady_clock::now());
+    }
+
+    // Every thread the program uses. Every (instance, run) pair is a task in the
+    // pool, and parallel work inside a run (neighborhood evaluation and
+    // speculative candidates) is picked up by whichever workers are idle.
+#ifdef PARALLEL_NEIGHBORHOOD
+    constexpr bool bParallelNeighborhood = true;
+#else
+    constexpr bool bParallelNeighborhood = false;
+#endif
+    const bool bParallelRun = bParallelNeighborhood || 1 < config.speculation;
 #ifdef PARALLEL_EXECUTION
-        outf << "\"Name\",\"Average objective\",\"Best objective\",\"Improvement (%)\",\"Running time\"" << std::endl;
+    ThreadPool pool{std::max(1u, std::thread::hardware_concurrency())};
 #else
-        outf << "\"Name\",\"Best objective\",\"Improvement (%)\"" << std::endl;
+    ThreadPool pool{bParallelRun ? std::thread::hardware_concurrency() : 0};
 #endif
+    ThreadPool* const p_pool = bParallelRun ? &pool : nullptr;
+
+    // Possibility to run with argument paths aswell
+    // If that is the case, use them instead
+    if (!argFiles.empty())
+    {
+        files.clear();
+        for (const auto file : argFiles)
+            files.emplace_back(file, 0);
+    }
+
+#ifdef ALL_ALGORITHMS
+#pragma message("Building with all search algorithms")
+    const std::vector<std::pair<HeuristicParallelSignature, std::string>> searchAlgorithms{
+        {blindRandomSearch, "Random Search"},
+        {localSearch, "Local Search"},
+        {simulatedAnnealing, "Simulated Annealing (old)"},
+        {simulatedAnnealing2ElectricBoogaloo, "Simulated Annealing (new)"},
+        {adaptiveSearch, "Adaptive Search"}
+    };
+#else
+    const std::vector<std::tuple<std::string_view, HeuristicParallelSignatureCached, std::string>> searchEngines{
+        {"adaptive", &adaptiveCachedSearch, "Adaptive Cached Search"},
+        {"tabu", &tabuSearch, "Tabu Search"},
+        {"memetic", &memeticSearch, "Memetic Search"},
+        {"exact", &exactSearch, "Branch and Bound"}
+    };
+    if (searchNames.empty())
+        searchNames.push_back("adaptive");
+    std::vector<std::pair<HeuristicParallelSignatureCached, std::string>> searchAlgorithms;
+    for (const auto name : searchNames)
+    {
+        const auto engine = std::find_if(searchEngines.begin(), searchEngines.end(), [&](const auto& e){ return std::get<0>(e) == name; });
+        if (engine == searchEngines.end())
+        {
+            std::cout << "Unknown search \"" << name << "\". Exiting." << std::endl;
+            return 1;
+        }
+        searchAlgorithms.emplace_back(std::get<1>(*engine), std::get<2>(*engine));
+    }
 #endif
 
-        // Problem loading
+    // Problem loading. Everything is loaded up front so a bad file fails
+    // before any time is spent searching.
+    std::vector<Problem> problems;
+    problems.reserve(files.size());
+    for (const auto& [file, availableTime] : files)
+    {
         auto pResult = load(file);
         if (!pResult)
         {
             std::cout << pResult.err().what() << std::endl;
             return 1;
         }
-        const auto problem = pResult.val();
+        problems.push_back(std::move(pResult.val()));
+    }
 
-#ifdef ALL_ALGORITHMS
-#pragma message("Building with all search algorithms")
+#ifdef RUN_FOR_10_MINUTES
+    // Calculate available time for each run. (max microseconds for each run, floored)
+    // Every instance gets its slice of the total time, and its runs share
+    // that slice on every core.
+    constexpr long long MAX_SECONDS = 9 * 60;
+    constexpr auto MAX_TIME = std::chrono::duration_cast<TimeUnit>(std::chrono::seconds{MAX_SECONDS}).count();
+    const long long cores = std::max<std::size_t>(pool.size(), 1);
+    for (int i{0}; i < files.size(); ++i)
+    {
+        const long long slice = findAvailableTime<MAX_TIME, 3>(files.size(), i) - (0 < i ? findAvailableTime<MAX_TIME, 3>(files.size(), i - 1) : 0);
+        files[i].second = slice * cores / static_cast<long long>(RUN_COUNT * searchAlgorithms.size());
+    }
+#endif
 
-        const std::vector<std::pair<HeuristicParallelSignature, std::string>> searchAlgorithms{
-            {blindRandomSearch, "Random Search"},
-            {localSearch, "Local Search"},
-            {simulatedAnnealing, "Simulated Annealing (old)"},
-            {simulatedAnnealing2ElectricBoogaloo, "Simulated Annealing (new)"},
-            {adaptiveSearch, "Adaptive Search"}
-        };
+    /**
+     * @brief All runs of one algorithm on one instance. Runs add their results
+     * as they finish, and the last one to finish reports the job.
+     */
+    struct Job {
+        std::size_t instance;
+        std::size_t algorithm;
+        std::string_view name;
+        std::mutex m;
+        unsigned int runs;
+        unsigned int remainingRuns;
+        long long totalTime{0};
+        long long totalCost{0};
+        int bestCost{std::numeric_limits<int>::max()};
+        SolutionCached bestSolution{};
+        // Island model: runs of this job periodically exchange their best solutions
+        Archipelago archipelago;
+        // Best solution of any run of this job
+        SharedBest sharedBest;
+        // Cost of the last solution streamed, as only new bests of the whole job are streamed
+        std::atomic<int> streamedCost{std::numeric_limits<int>::max()};
+
+        Job(std::size_t instance, std::size_t algorithm, std::string_view name, MigrationTopology topology, unsigned int runs)
+            : instance{instance}, algorithm{algorithm}, name{name}, runs{runs}, remainingRuns{runs}, archipelago{runs, topology} {}
+    };
 
-        for (const auto& [search, algname] : searchAlgorithms)
-        {
-#ifndef NDEBUG
-            std::cout << "Algorithm: " << algname << std::endl;
-#endif
+    std::vector<std::unique_ptr<Job>> jobs;
+    jobs.reserve(files.size() * searchAlgorithms.size());
+    for (std::size_t i{0}; i < files.size(); ++i)
+        for (std::size_t a{0}; a < searchAlgorithms.size(); ++a)
+            jobs.push_back(std::make_unique<Job>(i, a, searchAlgorithms[a].second, config.migrationTopology, RUN_COUNT));
 
-#else
-            const auto& [search, algname] = std::make_pair<HeuristicParallelSignatureCached, std::string>(&adaptiveCachedSearch, "Adaptive Cached Search");
+#ifdef RUN_FOR_10_MINUTES
+    // Time left over by runs that converge early goes to the instances still improving
+    std::vector<TimeBudget::Duration> allocations;
+    for (const auto& job : jobs)
+        allocations.emplace_back(files[job->instance].second);
+    TimeBudget budget{allocations, RUN_COUNT};
 #endif
 
-            long long totalTime{0};
-            long long totalCost{0};
-            int bestCost{std::numeric_limits<int>::max()};
-            SolutionCached bestSolution{};
+    // Reports a finished job. Jobs finish in any order, so every report names its instance.
+    std::mutex outputMutex;
+    const auto report = [&](Job& job) {
+        const auto& problem = problems[job.instance];
+        const auto& algname = job.name;
+        std::lock_guard lock{outputMutex};
 
-            constexpr unsigned int THREAD_COUNT = 10;
+        auto improvementPercent = [&]() {
+            auto initCost = getCost(problem, genInitialSolution(problem));
+            auto bestCost = getFeasibleCost(problem, job.bestSolution);
 
-#ifdef PARALLEL_EXECUTION
-            std::vector<std::thread> threads{};
-            threads.reserve(THREAD_COUNT);
-            std::mutex m;
-#endif
+            return (initCost && bestCost) ? 100.0 * (initCost.val() - bestCost.val()) / initCost.val() : 0.0;
+        };
 
-            std::vector<std::future<int>> returnVals;
+        std::cout << std::endl << files[job.instance].first << ": " << algname << std::endl;
 
-            const auto loop = [&](std::promise<int> &&p, std::default_random_engine&& ran, const std::chrono::high_resolution_clock::time_point* p_start = nullptr, long long availableTime = -1) {
-                std::chrono::steady_clock::time_point t1{std::chrono::steady_clock::now()};
-                auto solution = search(problem, ran, p_start, availableTime);
-                auto duration = std::chrono::steady_clock::now() - t1;
+#ifndef NDEBUG
+#ifdef PARALLEL_EXECUTION
+        std::cout << "Average cost: " << static_cast<double>(job.totalCost) / job.runs << std::endl;
+        std::cout << "Average runtime: " << static_cast<double>(job.totalTime) / job.runs << "ms" << std::endl;
+#endif
+        std::cout << "Best cost: " << job.bestCost << std::endl;
+        std::cout << "Best solution: ";
+        for (const auto &v : fromNestedList(job.bestSolution))
+            std::cout << v << ", ";
+        std::cout << "Improvement (%): " << std::to_string(improvementPercent()) << std::endl;
+#endif
 
-                // Scope so mutex lock can do it's thing.
-                {
+#ifdef FILE_OUTPUT
+        // Write results to file:
+        outf << std::filesystem::path{files[job.instance].first}.filename().string() << std::endl;
 #ifdef PARALLEL_EXECUTION
-                    std::lock_guard lock{m};
+        outf << "\"Name\",\"Average objective\",\"Best objective\",\"Improvement (%)\",\"Running time\"" << std::endl;
+#else
+        outf << "\"Name\",\"Best objective\",\"Improvement (%)\"" << std::endl;
 #endif
-#ifndef NDEBUG
-                    std::cout << "Best solution: ";
-                    for (auto l = fromNestedList(solution); auto v : l)
-                    {
-                        std::cout << std::to_string(v) << ",";
-                    }
-                    std::cout << std::endl;
+        outf << "\"" << algname << "\",";
+        outf << job.totalCost / job.runs << ",";
+#ifdef PARALLEL_EXECUTION
+        outf << job.bestCost << ",";
 #endif
-                    auto cResult = getFeasibleCost(problem, solution);
-#ifndef NDEBUG
-                    if (!cResult)
-                    {
-                        std::cout << cResult.err().what() << std::endl;
-                        p.set_value(1);
-                        return;
-                    }
+        outf << std::fixed << std::setprecision(2) << improvementPercent();
+#ifdef PARALLEL_EXECUTION
+        outf << "," << static_cast<double>(job.totalTime) / job.runs << "ms";
 #endif
-                    const auto cost = cResult.val();
-                    if (cost < bestCost)
-                    {
-                        bestCost = cost;
-                        bestSolution = solution;
-                    }
-                    totalCost += cost;
-
-                    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
-                    totalTime += ms;
+        outf << std::endl << std::endl;
 
-#ifndef NDEBUG
-                    std::cout << "Cost: " << cost << std::endl;
-                    std::cout << "runtime: " << ms << "ms" << std::endl;
+        // Write solutions to file
+        outs << std::filesystem::path{files[job.instance].first}.filename().string() << ": ";
+        for (const auto &v : fromNestedList(job.bestSolution))
+            outs << v << " ";
+        outs << std::endl;
 #endif
-                }
-
-                // Remember to set return value
-                p.set_value(0);
-            };
-
-#ifdef PARALLEL_EXECUTION
+    };
 
-            // Init promises (for return values for each thread)
-            std::vector<std::promise<int>> promises;
-            promises.resize(THREAD_COUNT);
-            returnVals.reserve(THREAD_COUNT);
+    // A single (instance, run) pair
+    const auto run = [&](Job& job, unsigned int i) -> int {
+        const auto& problem = problems[job.instance];
+        auto ran = Random{streamSeed(seed, {static_cast<std::uint32_t>(job.instance), static_cast<std::uint32_t>(job.algorithm), i})};
+        const Cooperation cooperation{
+            config.bIslands ? &job.archipelago : nullptr,
+            static_cast<std::size_t>(i),
+            config.migrationInterval,
+            config.bSharedBest ? &job.sharedBest : nullptr
+        };
 
-            // Init threads
-            for (auto i{0}; i < THREAD_COUNT; ++i)
-            {
-                auto p = std::move(promises[i]);
-                returnVals.push_back(p.get_future());
-                auto ran = std::default_random_engine{static_cast<unsigned int>(std::time(nullptr) + i * 3)};
+        // Time budgets are per run, counted from when the run is picked up
+        const auto start = std::chrono::high_resolution_clock::now();
+        StopReason stopReason{StopReason::Iterations};
+        auto solution = [&]() {
 #ifdef RUN_FOR_10_MINUTES
-                threads.push_back(std::thread{loop, std::move(p), std::move(ran), &program_start, availableTime});
+            // Hands over whatever time the run didn't use as soon as it's done
+            TimeBudget::Run runBudget{budget, job.instance * searchAlgorithms.size() + job.algorithm};
+            TimeBudget::Run* const p_budget = &runBudget;
 #else
-                threads.push_back(std::thread{loop, std::move(p), std::move(ran)});
+            TimeBudget::Run* const p_budget = nullptr;
 #endif
-            }
+            // One checkpoint file per (instance, run) pair
+            const Checkpoint checkpoint{
+                checkpointDir / (std::filesystem::path{files[job.instance].first}.stem().string() + "." + std::to_string(job.algorithm) + "." + std::to_string(i) + ".ckpt"),
+                std::chrono::seconds{config.checkpointInterval},
+                bResume
+            };
+            const ImprovementObserver observer = [&](const SolutionCached& best, int cost) {
+                for (auto streamed = job.streamedCost.load(std::memory_order_relaxed); cost < streamed;)
+                    if (job.streamedCost.compare_exchange_weak(streamed, cost, std::memory_order_relaxed))
+                    {
+                        stream->publish(std::filesystem::path{files[job.instance].first}.filename().string(), i, cost, best);
+                        break;
+                    }
+            };
+            return searchAlgorithms[job.algorithm].first(problem, ran, p_budget, p_pool, &config, &cooperation, checkpointDir.empty() ? nullptr : &checkpoint, stream ? &observer : nullptr, nullptr, &stopReason);
+        }();
+        auto duration = std::chrono::high_resolution_clock::now() - start;
 
-            // Wait for all threads to finish
-            // for (auto& [t, f] : Zip{threads, returnVals}) {
-            //     t.join();
-            //     if (0 != f.get())
-            //         return f.get();
-            // }
+        auto cResult = getFeasibleCost(problem, solution);
+#ifndef NDEBUG
+        if (!cResult)
+        {
+            std::lock_guard lock{outputMutex};
+            std::cout << cResult.err().what() << std::endl;
+            return 1;
+        }
+#endif
+        const auto cost = cResult.val();
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
 
-            auto [tit, rit] = std::make_tuple(threads.begin(), returnVals.begin());
-            for (; tit != threads.end() && rit != returnVals.end(); ++tit, ++rit)
+        bool bLastRun;
+        // Scope so mutex lock can do it's thing.
+        {
+            std::lock_guard lock{job.m};
+            if (cost < job.bestCost)
             {
-                auto &t = *tit;
-                auto &f = *rit;
-                t.join();
-                if (0 != f.get())
-                    return f.get();
+                job.bestCost = cost;
+                job.bestSolution = std::move(solution);
             }
+            job.totalCost += cost;
+            job.totalTime += ms;
+            bLastRun = 0 == --job.remainingRuns;
+        }
 
-#else
-            // If non-multithread, run loop manually. Once.
-            std::promise<int> p{};
-            auto f = p.get_future();
-            loop(std::move(p), std::default_random_engine{static_cast<unsigned int>(std::time(nullptr))}, &program_start, availableTime);
-            if (0 != f.get())
-                return f.get();
-#endif
-
-            auto improvementPercent = [&]() {
-                auto initCost = getCost(problem, genInitialSolution(problem));
-                auto bestCost = getFeasibleCost(problem, bestSolution);
-
-                return (initCost && bestCost) ? 100.0 * (initCost.val() - bestCost.val()) / initCost.val() : 0.0;
-            };
-
-#ifndef NDEBUG
-            std::cout << std::endl
-                      << std::endl;
+        {
+            std::lock_guard lock{outputMutex};
+            std::cout << files[job.instance].first << " run " << i << ": cost " << cost << ", runtime " << ms << "ms, stopped: " << describe(stopReason) << std::endl;
+        }
 
-#ifdef PARALLEL_EXECUTION
-            std::cout << "Average cost: " << static_cast<double>(totalCost) / THREAD_COUNT << std::endl;
-            std::cout << "Average runtime: " << static_cast<double>(totalTime) / THREAD_COUNT << "ms" << std::endl;
-#endif
-            std::cout << "Best cost: " << bestCost << std::endl;
-            std::cout << "Best solution: ";
-            for (const auto &v : fromNestedList(bestSolution))
-                std::cout << v << ", ";
-            std::cout << "Improvement (%): " << std::to_string(improvementPercent()) << std::endl;
-#endif
+        if (bLastRun)
+            report(job);
+        return 0;
+    };
 
-#ifdef FILE_OUTPUT
-            // Write results to file:
-            outf << "\"" << algname << "\",";
-            outf << totalCost / THREAD_COUNT << ",";
-#ifdef PARALLEL_EXECUTION            
-            outf << bestCost << ",";
-#endif
-            outf << std::fixed << std::setprecision(2) << improvementPercent();
-#ifdef PARALLEL_EXECUTION
-            outf << "," << static_cast<double>(totalTime) / 10.0 << "ms";
-#endif
-            outf << std::endl;
+    // Small instances are solved exactly, once, instead of RUN_COUNT times by
+    // every search. Instances the exact search can't prove optimal within
+    // exact_nodes nodes are searched as usual.
+    std::vector<char> bSolved(problems.size(), false);
+    std::vector<std::unique_ptr<Job>> exactJobs;
+    for (std::size_t i{0}; i < problems.size(); ++i)
+    {
+        if (config.exactCalls < problems[i].calls.size())
+            continue;
+        if (!triangleInequality(problems[i]))
+        {
+            std::cout << files[i].first << ": travel costs or times break the triangle inequality, so optimality can't be proved. Searching instead." << std::endl;
+            continue;
+        }
+        const auto start = std::chrono::high_resolution_clock::now();
+        auto result = branchAndBound(problems[i], nullptr, config.exactNodes);
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        if (!result.bOptimal)
+        {
+            std::cout << files[i].first << ": not proved optimal within " << result.nodes << " nodes (" << ms << "ms), searching instead" << std::endl;
+            continue;
+        }
 
-            // Write solutions to file
-            for (const auto &v : fromNestedList(bestSolution))
-                outs << v << " ";
-            outs << std::endl;
+        bSolved[i] = true;
+        auto& job = *exactJobs.emplace_back(std::make_unique<Job>(i, 0, "Branch and Bound", config.migrationTopology, 1));
+        job.remainingRuns = 0;
+        job.bestCost = result.cost;
+        job.bestSolution = std::move(result.solution);
+        job.totalCost = result.cost;
+        job.totalTime = ms;
+        std::cout << files[i].first << " run 0: cost " << result.cost << ", runtime " << ms << "ms, stopped: " << describe(StopReason::Optimal) << std::endl;
+        if (stream)
+            stream->publish(std::filesystem::path{files[i].first}.filename().string(), 0, result.cost, job.bestSolution);
+        report(job);
+    }
 
-#endif
-#ifdef ALL_ALGORITHMS
+    // Queue every (instance, run) pair at once, biggest instances first, so
+    // the longest jobs start early and the small ones fill in the gaps.
+    std::vector<Job*> order;
+    for (const auto& job : jobs)
+    {
+        if (!bSolved[job->instance])
+        {
+            order.push_back(job.get());
+            continue;
         }
+#ifdef RUN_FOR_10_MINUTES
+        // Runs that never start hand over all of their time right away
+        for (unsigned int i{0}; i < RUN_COUNT; ++i)
+            TimeBudget::Run{budget, job->instance * searchAlgorithms.size() + job->algorithm};
 #endif
-#ifdef FILE_OUTPUT
-        outf << std::endl;
-#endif
-
     }
+    std::stable_sort(order.begin(), order.end(), [&](const Job* a, const Job* b){
+        return problems[b->instance].calls.size() < problems[a->instance].calls.size();
+    });
+
+    std::vector<std::future<int>> returnVals;
+    returnVals.reserve(order.size() * RUN_COUNT);
+    for (auto* job : order)
+        for (unsigned int i{0}; i < RUN_COUNT; ++i)
+            returnVals.push_back(pool.submit([&run, job, i](){ return run(*job, i); }));
+
+    // Wait for all runs to finish before bailing out, as they reference this scope
+    int ret{0};
+    for (auto& f : returnVals)
+    {
+        try
+        {
+            if (const auto r = f.get(); 0 != r)
+                ret = r;
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << e.what() << std::endl;
+            ret = 1;
+        }
+    }
+    if (0 != ret)
+        return ret;
 
     std::cout << "Program execution time: " << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::high_resolution_clock::now() - program_start).count() << " seconds." << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief Unbounded lock-free queue for many producers and a single consumer
+ * Producers link in a new node with a single atomic exchange, so pushing
+ * never waits on other producers or on the consumer. The consumer owns the
+ * tail and is the only one freeing nodes.
+ * @see https://www.1024cores.net/home/lock-free-algorithms/queues/non-intrusive-mpsc-node-based-queue
+ * @tparam T Element type, needs to be default constructible
+ */
+template <typename T>
+class MpscQueue {
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node*> head;    // Last pushed node
+    Node* tail;                 // Node before the next to be popped
+
+public:
+    MpscQueue() : head{new Node}, tail{head.load(std::memory_order_relaxed)} {}
+    ~MpscQueue() {
+        while (tail != nullptr) {
+            auto* next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /// Any thread
+    void push(T value) {
+        auto* node = new Node;
+        node->value = std::move(value);
+        auto* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * Consumer thread only. Might come up empty for a moment while a push
+     * is halfway through, even if that push started before this call.
+     */
+    std::optional<T> pop() {
+        auto* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+            return std::nullopt;
+        std::optional<T> out{std::move(next->value)};
+        delete tail;
+        tail = next;
+        return out;
+    }
+};
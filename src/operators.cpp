@@ -2,15 +2,18 @@
 #include <algorithm>
 #include <limits>
 #include <random>
-#include <ctime>
 #include <numeric>
 #include <set>
 #include <array>
 #include <optional>
 #include <thread>
 #include <future>
+#include <cmath>
+#include <tuple>
 #include "feasibility.h"
 #include "cost.h"
+#include "schedule.h"
+#include "threadpool.h"
 
 template <typename T>
 auto find_nested_minmax(const T& begin, const T& end){
@@ -31,24 +34,6 @@ auto find_nested_minmax(const T& begin, const T& end){
     return begin == end ? std::pair<vT, vT>{} : vals;
 }
 
-template <>
-auto find_nested_minmax<typename SolutionCached::iterator>(const typename SolutionCached::iterator& begin, const typename SolutionCached::iterator& end){
-    using itT = typename SolutionCached::value_type;
-    std::pair vals{
-        std::numeric_limits<int>::max(),
-        std::numeric_limits<int>::min()
-    };
-    for (auto it{begin}; it != end; ++it) {
-        for (const auto& l = it->calls; const auto& v : l) {
-            if (v < vals.first)
-                vals.first = v;
-            if (vals.second < v)
-                vals.second = v;
-        }
-    }
-    return begin == end ? std::pair<int, int>{} : vals;
-}
-
 // minmax for compact solution representation
 template <typename T>
 auto find_minmax(const T& begin, const T& end) {
@@ -69,21 +54,97 @@ auto find_minmax(const T& begin, const T& end) {
     return begin == end ? std::pair<vT, vT>{} : vals;
 }
 
-static std::default_random_engine ran{static_cast<unsigned int>(std::time(nullptr))};
+// Helpers for the ruin and recreate operators
+namespace {
+// Moves a call from a vehicle into the dummy
+void moveToDummy(SolutionCached& s, index_t vehicle, index_t call) {
+    callIndex(s).assign(call, static_cast<index_t>(s.size() - 1));
+    erase(s[vehicle].calls, call);
+    s[vehicle].bChanged = true;
+    s.back().calls.push_back(call);
+    s.back().calls.push_back(call);
+    s.back().bChanged = true;
+}
 
-namespace op {
-// 2-exchange operator
-Solution ex2(Solution s) {
-    return ex2(s, ran);
+// K different random calls out of [0, n), without retrying on collisions
+template <std::size_t K>
+std::array<index_t, K> distinctCalls(std::size_t n, Random& ran) {
+    std::array<index_t, K> out;
+    std::array<index_t, K> drawn;
+    for (std::size_t i{0}; i < K; ++i) {
+        auto c = static_cast<index_t>(randomIndex(ran, n - i));
+        // Step past the calls already drawn, lowest first, so c ends up as the c-th call not yet drawn
+        for (std::size_t j{0}; j < i; ++j)
+            if (drawn[j] <= c)
+                ++c;
+        out[i] = c;
+        drawn[i] = c;
+        std::sort(drawn.begin(), drawn.begin() + i + 1);
+    }
+    return out;
+}
+
+// Replaces every stop of from[i] with to[i], where to is a permutation of from.
+// Only the vehicles holding the calls are searched.
+template <std::size_t K>
+void permuteCalls(SolutionCached& s, const std::array<index_t, K>& from, const std::array<index_t, K>& to) {
+    auto& index = callIndex(s);
+    std::array<index_t, K> vehicles;
+    for (std::size_t i{0}; i < K; ++i)
+        vehicles[i] = index.vehicleOf(from[i]);
+
+    for (std::size_t i{0}; i < K; ++i) {
+        if (std::find(vehicles.begin(), vehicles.begin() + i, vehicles[i]) != vehicles.begin() + i)
+            continue; // Vehicle already handled
+        auto& l = s[vehicles[i]];
+        for (auto& c : l.calls)
+            if (const auto it = std::find(from.begin(), from.end(), c); it != from.end())
+                c = to[it - from.begin()];
+        l.bChanged = true;
+    }
+
+    for (std::size_t i{0}; i < K; ++i)
+        index.assign(to[i], vehicles[i]);
+}
+
+// Takes a random call out of its vehicle and returns it
+index_t takeRandomCall(SolutionCached& s, Random& ran) {
+    const auto& index = callIndex(s);
+    const auto call = static_cast<index_t>(randomIndex(ran, index.size()));
+    auto& l = s[index.vehicleOf(call)];
+    erase(l.calls, call);
+    l.bChanged = true;
+    return call;
+}
+
+// Random vehicle (excluding dummy) with at least minStops stops in its route
+std::optional<index_t> randomVehicle(const SolutionCached& s, std::size_t minStops, Random& ran) {
+    std::vector<index_t> vehicles;
+    vehicles.reserve(s.size());
+    for (index_t v{0}; v + 1 < s.size(); ++v)
+        if (minStops <= s[v].calls.size())
+            vehicles.push_back(v);
+    if (vehicles.empty())
+        return std::nullopt;
+    return vehicles[randomIndex(ran, vehicles.size())];
 }
 
-Solution ex2(Solution s, std::default_random_engine& ran) {
+// Random index in [0, n) skewed towards 0. Higher power = more skewed.
+std::size_t skewedIndex(std::size_t n, double power, Random& ran) {
+    const auto y = randomUnit(ran);
+    return std::min(n - 1, static_cast<std::size_t>(std::pow(y, power) * n));
+}
+}
+
+namespace op {
+// 2-exchange operator
+Solution ex2(Solution s, Random& ran) {
     const auto [min, max] = find_nested_minmax(s.begin(), s.end());
     if (max - min < 2)
         return s;
 
     // Find two random call ids
-    const auto r = [&](){ return ran() % (max + 1 - min) + min; };
+    const auto r = [&](){ return randomIndex(ran, max + 1 - min) + min; };
     auto a{r()}, b{r()};
     // Loop until you have two different ones:
     // Note: If really unlucky might loop for a long time
@@ -126,66 +187,24 @@ Solution ex2(Solution s, std::default_random_engine& ran) {
     return s;
 }
 
-SolutionCached ex2(SolutionCached s, std::default_random_engine& ran) {
-    const auto [min, max] = find_nested_minmax(s.begin(), s.end());
-    if (max - min < 2)
+SolutionCached ex2(SolutionCached s, Random& ran) {
+    const auto n = callIndex(s).size();
+    if (n < 2)
         return s;
 
-    // Find two random call ids
-    const auto r = [&](){ return ran() % (max + 1 - min) + min; };
-    auto a{r()}, b{r()};
-    // Loop until you have two different ones:
-    // Note: If really unlucky might loop for a long time
-    while (a == b)
-        b = r();
-
-    // It should be guaranteed that the random calls are represented in the solution (else it would be invalid)
-    std::pair<int*, int*>   apos{std::make_pair(nullptr, nullptr)},
-                            bpos{std::make_pair(nullptr, nullptr)};
-    for (auto& l : s) {
-        for (auto it{l.calls.begin()}; it != l.calls.end(); ++it) {
-            const auto& v = *it;
-
-            if (v == a) {
-                if (!apos.first)
-                    apos.first = &(*it);
-                else
-                    apos.second = &(*it);
-                l.bChanged = true;
-            }
-
-            if (v == b) {
-                if (!bpos.first)
-                    bpos.first = &(*it);
-                else
-                    bpos.second = &(*it);
-                l.bChanged = true;
-            }
-        }
-    }
-
-#ifdef _DEBUG
-    // Early termination in case we somehow ended up with nullptr's
-    for (const auto& [a, b] : {apos, bpos})
-        if (!a || !b)
-            throw std::runtime_error{"Attempting to swap nullptr"};
-#endif
-
-    // Swap first:
-    std::swap(*apos.first, *bpos.first);
-    // Swap last:
-    std::swap(*apos.second, *bpos.second);
-
+    // Swap two random calls
+    const auto [a, b] = distinctCalls<2>(n, ran);
+    permuteCalls<2>(s, {a, b}, {b, a});
     return s;
 }
 
-SolutionComp ex2_comp(SolutionComp s) {
+SolutionComp ex2_comp(SolutionComp s, Random& ran) {
     const auto [min, max] = find_minmax(s.begin(), s.end());
     if (max - min < 2)
         return s;
 
     // Find two random call ids
-    const auto r = [&](){ return ran() % (max + 1 - min) + min; };
+    const auto r = [&](){ return randomIndex(ran, max + 1 - min) + min; };
     auto a{r()}, b{r()};
     // Loop until you have two different ones:
     // Note: If really unlucky might loop for a long time
@@ -228,12 +247,12 @@ SolutionComp ex2_comp(SolutionComp s) {
     return s;
 }
 
-bool exchance(std::vector<int>& c1, std::vector<int>& c2) {
+bool exchance(std::vector<int>& c1, std::vector<int>& c2, Random& ran) {
     if (c1.empty() || c2.empty())
         return false;
 
-    const auto  a{c1.at(ran() % c1.size())},
-                b{c2.at(ran() % c2.size())};
+    const auto  a{c1.at(randomIndex(ran, c1.size()))},
+                b{c2.at(randomIndex(ran, c2.size()))};
 
     // It should be guaranteed that the random calls are represented in the solution (else it would be invalid)
     std::pair<int*, int*>   apos{std::make_pair(nullptr, nullptr)},
@@ -278,17 +297,13 @@ bool exchance(std::vector<int>& c1, std::vector<int>& c2) {
 }
 
 // 3-exchange operator
-Solution ex3(Solution s) {
-    return ex3(s, ran);
-}
-
-Solution ex3(Solution s, std::default_random_engine& ran) {
+Solution ex3(Solution s, Random& ran) {
     const auto [min, max] = find_nested_minmax(s.begin(), s.end());
     if (max - min < 3)
         return s;
 
     // Find three random call ids
-    const auto r = [&](){ return ran() % (max + 1 - min) + min; };
+    const auto r = [&](){ return randomIndex(ran, max + 1 - min) + min; };
     auto a{r()}, b{r()}, c{r()};
     // Loop until you have three different ones:
     // Note: If really unlucky might loop for a long time
@@ -342,79 +357,24 @@ Solution ex3(Solution s, std::default_random_engine& ran) {
     return s;
 }
 
-SolutionCached ex3(SolutionCached s, std::default_random_engine& ran) {
-    const auto [min, max] = find_nested_minmax(s.begin(), s.end());
-    if (max - min < 3)
+SolutionCached ex3(SolutionCached s, Random& ran) {
+    const auto n = callIndex(s).size();
+    if (n < 3)
         return s;
 
-    // Find three random call ids
-    const auto r = [&](){ return ran() % (max + 1 - min) + min; };
-    auto a{r()}, b{r()}, c{r()};
-    // Loop until you have three different ones:
-    // Note: If really unlucky might loop for a long time
-    while (a == b)
-        b = r();
-    while (a == c || b == c)
-        c = r();
-
-    // It should be guaranteed that the random calls are represented in the solution (else it would be invalid)
-    std::pair<int*, int*>   apos{std::make_pair(nullptr, nullptr)},
-                            bpos{std::make_pair(nullptr, nullptr)},
-                            cpos{std::make_pair(nullptr, nullptr)};
-    for (auto& l : s) {
-        for (auto it{l.calls.begin()}; it != l.calls.end(); ++it) {
-            const auto& v = *it;
-
-            if (v == a) {
-                if (!apos.first)
-                    apos.first = &(*it);
-                else
-                    apos.second = &(*it);
-                l.bChanged = true;
-            }
-
-            if (v == b) {
-                if (!bpos.first)
-                    bpos.first = &(*it);
-                else
-                    bpos.second = &(*it);
-                l.bChanged = true;
-            }
-
-            if (v == c) {
-                if (!cpos.first)
-                    cpos.first = &(*it);
-                else
-                    cpos.second = &(*it);
-                l.bChanged = true;
-            }
-        }
-    }
-
-#ifdef _DEBUG
-    // Early termination in case we somehow ended up with nullptr's
-    for (const auto& [a, b] : {apos, bpos, cpos})
-        if (!a || !b)
-            throw std::runtime_error{"Attempting to swap nullptr"};
-#endif
-
-    // Swap first:
-    std::swap(*apos.first, *bpos.first);
-    std::swap(*bpos.first, *cpos.first);
-    // Swap last:
-    std::swap(*apos.second, *bpos.second);
-    std::swap(*bpos.second, *cpos.second);
-
+    // Rotate three random calls: a takes the place of c, b of a and c of b
+    const auto [a, b, c] = distinctCalls<3>(n, ran);
+    permuteCalls<3>(s, {a, b, c}, {b, c, a});
     return s;
 }
 
-SolutionComp ex3_comp(SolutionComp s) {
+SolutionComp ex3_comp(SolutionComp s, Random& ran) {
     const auto [min, max] = find_minmax(s.begin(), s.end());
     if (max - min < 3)
         return s;
 
     // Find three random call ids
-    const auto r = [&](){ return ran() % (max + 1 - min) + min; };
+    const auto r = [&](){ return randomIndex(ran, max + 1 - min) + min; };
     auto a{r()}, b{r()}, c{r()};
     // Loop until you have three different ones:
     // Note: If really unlucky might loop for a long time
@@ -469,151 +429,93 @@ SolutionComp ex3_comp(SolutionComp s) {
 }
 
 // 1-reinsert operator
-Solution ins1(Solution s) {
-    return ins1(s, ran);
-}
-
-Solution ins1(Solution s, std::default_random_engine& ran) {
+Solution ins1(Solution s, Random& ran) {
     const auto [min, max] = find_nested_minmax(s.begin(), s.end());
     if (min == max)
         return s;
 
     // Find a random call id
-    const auto a = ran() % (max + 1 - min) + min;
+    const auto a = randomIndex(ran, max + 1 - min) + min;
 
     // Remove from list:
     for (auto& l : s)
         std::erase(l, a);
     
     // Insert two of call id into random car:
-    auto& car = s[ran() % s.size()];
+    auto& car = s[randomIndex(ran, s.size())];
     // Optional hint to compiler to add more make next two inserts cheaper
     car.reserve(car.size() + 2);
     if (car.empty())
         car.push_back(a);
     else
-        car.insert(car.begin() + ran() % car.size(), a);
+        car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     // No reason to check second time because size will atleast be 1
-    car.insert(car.begin() + ran() % car.size(), a);
+    car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     return s;
 }
 
-SolutionCached ins1(SolutionCached s, std::default_random_engine& ran) {
-    const auto [min, max] = find_nested_minmax(s.begin(), s.end());
-    if (min == max)
+SolutionCached ins1(SolutionCached s, Random& ran) {
+    if (callIndex(s).size() < 2)
         return s;
 
-    // Find a random call id
-    const auto a = ran() % (max + 1 - min) + min;
-
-    // Remove from list:
-    for (auto& l : s)
-        if (0 < std::erase(l.calls, a))
-            l.bChanged = true;
+    // Take out a random call
+    const auto a = takeRandomCall(s, ran);
     
     // Insert two of call id into random car: (exclude dummy)
-    const auto ranIndex = ran() % (s.size() - 1);
+    const auto ranIndex = randomIndex(ran, s.size() - 1);
     auto& car = s[ranIndex].calls;
     // Optional hint to compiler to add more make next two inserts cheaper
     car.reserve(car.size() + 2);
     if (car.empty())
         car.push_back(a);
     else
-        car.insert(car.begin() + ran() % car.size(), a);
+        car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     // No reason to check second time because size will atleast be 1
-    car.insert(car.begin() + ran() % car.size(), a);
+    car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     s[ranIndex].bChanged = true;
+    s.index.assign(a, static_cast<index_t>(ranIndex));
 
     return s;
 }
 
-SolutionComp ins1_comp(SolutionComp s) {
-    return fromNestedListZeroIndexed(ins1(toNestedList(s)));
-
-    // Currently can't get this shit to work, so commented out for the time being
-/*
+SolutionComp ins1_comp(SolutionComp s, Random& ran) {
     const auto [min, max] = find_minmax(s.begin(), s.end());
     if (min == max)
         return s;
 
     // Find a random call id
-    const auto a = ran() % (max + 1 - min) + min;
-    
-    std::vector<std::pair<int, int>> carIndexes;
-    // Count cars and pos of a:
-    auto aindex{-1}, start{0};
-    for (auto i{0}; i < s.size(); ++i) {
-        if (s[i] == a && aindex < 0)
-            aindex = i;
-        if (s[i] == -1) {
-            carIndexes.emplace_back(start, start + 1);
-            start = i + 1;
-        }
-    }
-    // Dummy vehicle at the end
-    carIndexes.emplace_back(start, s.size());
-
-    // Choose a random car:
-    const auto car = ran() % carIndexes.size();
-
-    // Choose 2 random indexes in that car:
-    const auto cindex = carIndexes[car];
-    const auto i1 = cindex.first + ran() % (cindex.second - cindex.first);
-    auto i2{i1};
-    while (i1 == i2)
-        i2 = cindex.first + ran() % (cindex.second - cindex.first + 1); // Offset by one because of i1
+    const auto a = randomIndex(ran, max + 1 - min) + min;
 
-    const bool forward = aindex <= i1 && aindex <= i2;
-    
-    if (forward) {
-        for (int i{0}, offset{0}; i < s.size(); ++i) {
-            if (s[i] == a) {
-                offset -= 1;
-                continue;
-            }
+    // Remove from list: (keeps capacity, so the reinsert below won't allocate)
+    s.erase(std::remove(s.begin(), s.end(), a), s.end());
 
-            if (offset != 0) {
-                if (i == i1 || i == i2) {
-                    s[i] = a;
-                    offset += 1;
-                } else {
-                    s[i + offset] = s[i];
-                }
-            }
-        }
-    } else {
-        for (int i{static_cast<int>(s.size()) - 1}, offset{0}; 0 < i; --i) {
-            if (s[i] == a) {
-                offset += 1;
-                continue;
-            }
+    // Find the range of a random car:
+    const auto carCount = static_cast<std::size_t>(std::count(s.begin(), s.end(), -1)) + 1;
+    auto route = routes(s).begin();
+    for (auto car = randomIndex(ran, carCount); 0 < car; --car)
+        ++route;
+    const auto begin = route.offset();
+    const auto size = (*route).size();
 
-            if (offset != 0) {
-                if (i == i1 || i == i2) {
-                    s[i] = a;
-                    offset -= 1;
-                } else {
-                    s[i + offset] = s[i];
-                }
-            }
-        }
-    }
+    // Insert two of call id into random car:
+    s.insert(s.begin() + begin + (size == 0 ? 0 : randomIndex(ran, size)), a);
+    // No reason to check second time because size will atleast be 1
+    s.insert(s.begin() + begin + randomIndex(ran, size + 1), a);
 
     return s;
-    */
 }
 
-Solution fesins(const Problem& p, Solution s) {
+Solution fesins(const Problem& p, Solution s, Random& ran) {
     const auto [min, max] = find_nested_minmax(s.begin(), s.end());
     if (min == max)
         return s;
 
     // Find a random call id
-    const auto a = ran() % (max + 1 - min) + min;
+    const auto a = randomIndex(ran, max + 1 - min) + min;
 
     // Remove from list:
     for (auto& l : s)
@@ -663,26 +565,20 @@ Solution fesins(const Problem& p, Solution s) {
     if (car.empty())
         car.push_back(a);
     else
-        car.insert(car.begin() + ran() % car.size(), a);
+        car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     // No reason to check second time because size will atleast be 1
-    car.insert(car.begin() + ran() % car.size(), a);
+    car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     return s;
 }
 
-SolutionCached fesins(const Problem& p, SolutionCached s, std::default_random_engine& ran) {
-    const auto [min, max] = find_nested_minmax(s.begin(), s.end());
-    if (min == max)
+SolutionCached fesins(const Problem& p, SolutionCached s, Random& ran) {
+    if (callIndex(s).size() < 2)
         return s;
 
-    // Find a random call id
-    const auto a = ran() % (max + 1 - min) + min;
-
-    // Remove from list:
-    for (auto& l : s)
-        if (0 < std::erase(l.calls, a))
-            l.bChanged = true;
+    // Take out a random call
+    const auto a = takeRandomCall(s, ran);
     
     // Find possible cars:
     std::vector<unsigned int> carIds;
@@ -728,28 +624,23 @@ SolutionCached fesins(const Problem& p, SolutionCached s, std::default_random_en
     if (car.empty())
         car.push_back(a);
     else
-        car.insert(car.begin() + ran() % car.size(), a);
+        car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     // No reason to check second time because size will atleast be 1
-    car.insert(car.begin() + ran() % car.size(), a);
+    car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     s[carIds[leastWeightRatio.second]].bChanged = true;
+    s.index.assign(a, static_cast<index_t>(carIds[leastWeightRatio.second]));
 
     return s;
 }
 
-SolutionCached validins(const Problem& p, SolutionCached s, std::default_random_engine& ran) {
-    const auto [min, max] = find_nested_minmax(s.begin(), s.end());
-    if (min == max)
+SolutionCached validins(const Problem& p, SolutionCached s, Random& ran) {
+    if (callIndex(s).size() < 2)
         return s;
 
-    // Find a random call id
-    const auto a = ran() % (max + 1 - min) + min;
-
-    // Remove from list:
-    for (auto& l : s)
-        if (0 < std::erase(l.calls, a))
-            l.bChanged = true;
+    // Take out a random call
+    const auto a = takeRandomCall(s, ran);
     
     // Find possible cars:
     std::vector<unsigned int> carIds;
@@ -764,24 +655,25 @@ SolutionCached validins(const Problem& p, SolutionCached s, std::default_random_
     carIds.push_back(static_cast<unsigned int>(p.vehicles.size()));
 
     // Insert two of call id into random car:
-    const auto carId = carIds[ran() % carIds.size()];
+    const auto carId = carIds[randomIndex(ran, carIds.size())];
     auto& car = s[carId].calls;
     // Optional hint to compiler to add more make next two inserts cheaper
     car.reserve(car.size() + 2);
     if (car.empty())
         car.push_back(a);
     else
-        car.insert(car.begin() + ran() % car.size(), a);
+        car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     // No reason to check second time because size will atleast be 1
-    car.insert(car.begin() + ran() % car.size(), a);
+    car.insert(car.begin() + randomIndex(ran, car.size()), a);
 
     s[carId].bChanged = true;
+    s.index.assign(a, static_cast<index_t>(carId));
 
     return s;
 }
 
-Solution freorder(const Problem& p, Solution s) {
+Solution freorder(const Problem& p, Solution s, Random& ran) {
     // Find cars we can operate on
     std::vector<uint16_t> applicableCars;
     applicableCars.reserve(s.size()-1);
@@ -793,12 +685,12 @@ Solution freorder(const Problem& p, Solution s) {
     if (applicableCars.empty())
         return s;
 
-    const auto carIndex = applicableCars.at(ran() % applicableCars.size());
+    const auto carIndex = applicableCars.at(randomIndex(ran, applicableCars.size()));
     auto& car = s.at(carIndex);
     // Choose two random calls from car:
-    int a{car.at(ran() % car.size())},b{a};
+    int a{car.at(randomIndex(ran, car.size()))},b{a};
     while (b == a)
-        b = car.at(ran() % car.size());
+        b = car.at(randomIndex(ran, car.size()));
 
     // Each possible configuration for sets:
     const std::array<std::array<int, 4>, 6> configurations{
@@ -855,7 +747,7 @@ Solution freorder(const Problem& p, Solution s) {
     return s;
 }
 
-SolutionCached freorder(const Problem& p, SolutionCached s, std::default_random_engine& ran) {
+SolutionCached freorder(const Problem& p, SolutionCached s, Random& ran) {
     // Find cars we can operate on
     std::vector<uint16_t> applicableCars;
     applicableCars.reserve(s.size()-1);
@@ -867,12 +759,12 @@ SolutionCached freorder(const Problem& p, SolutionCached s, std::default_random_
     if (applicableCars.empty())
         return s;
 
-    const auto carIndex = applicableCars.at(ran() % applicableCars.size());
+    const auto carIndex = applicableCars.at(randomIndex(ran, applicableCars.size()));
     auto& car = s.at(carIndex).calls;
     // Choose two random calls from car:
-    int a{car.at(ran() % car.size())},b{a};
+    int a{car.at(randomIndex(ran, car.size()))},b{a};
     while (b == a)
-        b = car.at(ran() % car.size());
+        b = car.at(randomIndex(ran, car.size()));
 
     // Each possible configuration for sets:
     const std::array<std::array<int, 4>, 6> configurations{
@@ -931,79 +823,52 @@ SolutionCached freorder(const Problem& p, SolutionCached s, std::default_random_
     return s;
 }
 
-Solution multishuffle(const Problem& p, Solution s) {
-    // Set a static seed to use for random number generation
-    static auto randomSeed{static_cast<unsigned int>(std::time(nullptr))};
-    using RetType = std::optional<std::pair<int, Solution>>;
-    
-    const auto threadCount = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads{};
-    threads.reserve(threadCount);
-    std::vector<std::future<RetType>> futures;
-    futures.reserve(threadCount);
-
-    const auto operation = [&p, &s](
-        std::promise<RetType>&& ret,
-        std::default_random_engine&& ran
-    ) -> void {
-        const auto newSolution = ins1(s, ran);
-        const auto feasability = checkfeasibility(p, newSolution);
-        if (!feasability) {
-            const auto cost = getCost(p, newSolution);
-            if (cost) {
-                ret.set_value(std::make_pair(cost.val_or_max(), newSolution));
-                return;
-            }
-        }
-
-        ret.set_value(std::nullopt);
+Solution multishuffle(const Problem& p, Solution s, Random& ran, ThreadPool* pool) {
+    const auto candidateCount = pool ? pool->size() + 1 : std::max(1u, std::thread::hardware_concurrency());
+    // Every candidate gets its own engine, seeded from the caller's
+    const auto seed = ran();
+
+    // One slot per candidate, so the result doesn't depend on which thread ran which
+    std::vector<std::optional<std::pair<int, Solution>>> candidates(candidateCount);
+    const auto evaluate = [&](std::size_t i) {
+        Random candidateRan{seed + i};
+        auto newSolution = ins1(s, candidateRan);
+        if (!checkfeasibility(p, newSolution))
+            if (const auto cost = getCost(p, newSolution))
+                candidates[i] = std::make_pair(cost.val_or_max(), std::move(newSolution));
     };
+    if (pool)
+        pool->parallelFor(candidateCount, evaluate);
+    else
+        for (std::size_t i{0}; i < candidateCount; ++i)
+            evaluate(i);
 
-    // Initiate threads
-    for (unsigned int i{0}; i < threadCount; ++i) {
-        std::promise<RetType> p{};
-        futures.push_back(p.get_future());
-        threads.emplace_back(operation, std::move(p), std::default_random_engine{randomSeed + i});
-    }
-
-    // Assemble and compare threads
+    // Assemble and compare candidates
     auto best = std::make_pair(std::numeric_limits<int>::max(), s);
-    for (auto i{0}; i < threads.size(); ++i) {
-        auto [t, f] = std::tie(threads.at(i), futures.at(i));
-        t.join();
-        if (!f.valid())
-            throw std::runtime_error{"Future is somehow not set..."};
-        const auto& opt = f.get();
-        if (opt) {
-            const auto& [cost, sol] = *opt;
-            if (cost < best.first)
-                best = *opt;
-        }
-    }
-
-    // Increment seed so we make sure we get different pseudo-random numbers next iteration.
-    randomSeed += threadCount;
+    for (auto& c : candidates)
+        if (c && c->first < best.first)
+            best = std::move(*c);
 
     return best.second;
 }
 
-Solution backinsert(const Problem& p, Solution s) {
+Solution backinsert(const Problem& p, Solution s, Random& ran) {
     constexpr float EXCHANCE_CHANCE = 0.4f;
 
     auto& dummy = s.back();
-    auto& car = s.at(ran() % (s.size() - 1));
+    auto& car = s.at(randomIndex(ran, s.size() - 1));
 
     // // 40% chance to do 2-exchance instead of reinsert
-    // if (ran() % 100 * 0.01 < EXCHANCE_CHANCE) {
+    // if (randomUnit(ran) < EXCHANCE_CHANCE) {
     //     // If we coudln't exchange, we can continue with the reinsert option instead.
-    //     if (exchance(car, dummy))
+    //     if (exchance(car, dummy, ran))
     //         return s;
     // }
 
     if (car.empty())
         return s;
 
-    const auto v = car.at(ran() % car.size());
+    const auto v = car.at(randomIndex(ran, car.size()));
     
     // Remove from car
     car.erase(std::remove(car.begin(), car.end(), v), car.end());
@@ -1013,8 +878,8 @@ Solution backinsert(const Problem& p, Solution s) {
     if (dummy.empty())
         dummy.push_back(v);
     else
-        dummy.insert(dummy.begin() + ran() % dummy.size(), v);
-    dummy.insert(dummy.begin() + ran() % dummy.size(), v);
+        dummy.insert(dummy.begin() + randomIndex(ran, dummy.size()), v);
+    dummy.insert(dummy.begin() + randomIndex(ran, dummy.size()), v);
 
 #ifdef _DEBUG
     for (const auto& c : s)
@@ -1025,26 +890,27 @@ Solution backinsert(const Problem& p, Solution s) {
     return s;
 }
 
-SolutionCached backinsert(const Problem& p, SolutionCached s, std::default_random_engine& ran) {
+SolutionCached backinsert(const Problem& p, SolutionCached s, Random& ran) {
     constexpr float EXCHANCE_CHANCE = 0.4f;
 
     auto& dummy = s.back().calls;
-    const auto carIndex = ran() % (s.size() - 1);
+    const auto carIndex = randomIndex(ran, s.size() - 1);
     auto& car = s.at(carIndex).calls;
 
     // // 40% chance to do 2-exchance instead of reinsert
-    // if (ran() % 100 * 0.01 < EXCHANCE_CHANCE) {
+    // if (randomUnit(ran) < EXCHANCE_CHANCE) {
     //     // If we coudln't exchange, we can continue with the reinsert option instead.
-    //     if (exchance(car, dummy))
+    //     if (exchance(car, dummy, ran))
     //         return s;
     // }
 
     if (car.empty())
         return s;
 
-    const auto v = car.at(ran() % car.size());
+    const auto v = car.at(randomIndex(ran, car.size()));
     
     // Remove from car
+    callIndex(s).assign(v, static_cast<index_t>(s.size() - 1));
     car.erase(std::remove(car.begin(), car.end(), v), car.end());
     s.at(carIndex).bChanged = true;
 
@@ -1053,8 +919,8 @@ SolutionCached backinsert(const Problem& p, SolutionCached s, std::default_rando
     if (dummy.empty())
         dummy.push_back(v);
     else
-        dummy.insert(dummy.begin() + ran() % dummy.size(), v);
-    dummy.insert(dummy.begin() + ran() % dummy.size(), v);
+        dummy.insert(dummy.begin() + randomIndex(ran, dummy.size()), v);
+    dummy.insert(dummy.begin() + randomIndex(ran, dummy.size()), v);
 
     s.back().bChanged = true;
 
@@ -1067,21 +933,24 @@ SolutionCached backinsert(const Problem& p, SolutionCached s, std::default_rando
     return s;
 }
 
-SolutionCached multibackinsert(const Problem& p, SolutionCached s, std::default_random_engine& ran) {
+SolutionCached multibackinsert(const Problem& p, SolutionCached s, Random& ran) {
     const auto callsInDummy = s.back().calls.size() / 2;
     const auto maxBackinserts = p.calls.size() - callsInDummy;
-    const auto insertCount = ran() % (maxBackinserts / 3);
+    const auto insertCount = randomIndex(ran, maxBackinserts / 3);
     for (auto i{0}; i < insertCount; ++i)
         s = backinsert(p, s, ran);
     return s;
 }
 
-SolutionCached priceinsert(const Problem& p, SolutionCached s, std::default_random_engine& ran) {
+SolutionCached priceinsert(const Problem& p, SolutionCached s, Random& ran) {
     // Take one from dummy
+    auto& index = callIndex(s);
     auto& dummy = s.back();
-    const auto call = dummy.calls.at(ran() % dummy.calls.size());
+    if (index.unservedCount() == 0)
+        return s;
+    const auto call = index.unservedCalls()[randomIndex(ran, index.unservedCount())];
     
-    std::erase(dummy.calls, call);
+    erase(dummy.calls, call);
     dummy.bChanged = true;
 
     // Find cheapest car to insert into:
@@ -1112,26 +981,338 @@ SolutionCached priceinsert(const Problem& p, SolutionCached s, std::default_rand
     const bool bFeasibleCar = !cheapestCars.empty();
 
     // Randomly insert into a possible car:
-    auto& car = bFeasibleCar ? s.at(cheapestCars.at(ran() % cheapestCars.size())) : dummy;
+    const auto carIndex = bFeasibleCar ? cheapestCars.at(randomIndex(ran, cheapestCars.size())) : static_cast<index_t>(s.size() - 1);
+    auto& car = s.at(carIndex);
+    index.assign(call, carIndex);
     car.calls.reserve(car.calls.size() + 2);
     if (car.calls.empty())
         car.calls.push_back(call);
     else
-        car.calls.insert(car.calls.begin() + ran() % car.calls.size(), call);
+        car.calls.insert(car.calls.begin() + randomIndex(ran, car.calls.size()), call);
 
     // No reason to check second time because size will atleast be 1
-    car.calls.insert(car.calls.begin() + ran() % car.calls.size(), call);
+    car.calls.insert(car.calls.begin() + randomIndex(ran, car.calls.size()), call);
 
     car.bChanged = true;
     
     return s;
 }
 
+SolutionCached regretinsert(const Problem& p, SolutionCached s, unsigned int k, ThreadPool* pool) {
+    auto& index = callIndex(s);
+    auto& dummy = s.back();
+    // Calls waiting in the dummy, sorted so ties are broken the same way every time
+    std::vector<index_t> pending{index.unservedCalls().begin(), index.unservedCalls().end()};
+    std::sort(pending.begin(), pending.end());
+    if (pending.empty() || k == 0)
+        return s;
+
+    const auto vCount = static_cast<index_t>(p.vehicles.size());
+    std::vector<RouteSchedule> schedules(vCount);
+    // Best insertion for every call in every vehicle: [call][vehicle]
+    std::vector<std::optional<Insertion>> options(p.calls.size() * vCount);
+    const auto updateOptions = [&](index_t v) {
+        for (const auto call : pending)
+            options[call * vCount + v] = bestInsertion(p, schedules[v], call);
+    };
+
+    // Every vehicle only writes to its own schedule and options, so they can be evaluated in parallel
+    const auto initVehicle = [&](std::size_t v) {
+        buildSchedule(p, static_cast<index_t>(v), s[v].calls, schedules[v]);
+        updateOptions(static_cast<index_t>(v));
+    };
+    if (pool)
+        pool->parallelFor(vCount, initVehicle);
+    else
+        for (index_t v{0}; v < vCount; ++v)
+            initVehicle(v);
+
+    std::vector<int> costs;
+    costs.reserve(vCount + 1);
+    while (!pending.empty()) {
+        // Find the call with highest regret. Calls with fewer than k options are
+        // prioritized (fewest options first) since they are the hardest to place.
+        std::size_t chosen{0};
+        std::pair<long long, long long> chosenKey{std::numeric_limits<long long>::min(), 0};
+        for (std::size_t i{0}; i < pending.size(); ++i) {
+            const auto call = pending[i];
+            costs.clear();
+            // Leaving the call in the dummy is always an option
+            costs.push_back(p.calls[call].costOfNotTransporting);
+            for (index_t v{0}; v < vCount; ++v)
+                if (const auto& o = options[call * vCount + v])
+                    costs.push_back(o->delta);
+
+            const auto considered = std::min<std::size_t>(k, costs.size());
+            std::partial_sort(costs.begin(), costs.begin() + considered, costs.end());
+            long long regret{0};
+            for (std::size_t h{1}; h < considered; ++h)
+                regret += costs[h] - costs[0];
+            // Regret-1 has no regret, so just insert the largest saving first (greedy insertion)
+            if (k == 1)
+                regret = p.calls[call].costOfNotTransporting - costs[0];
+
+            const std::pair<long long, long long> key{static_cast<long long>(k - considered), regret};
+            if (chosenKey < key) {
+                chosenKey = key;
+                chosen = i;
+            }
+        }
+
+        const auto call = pending[chosen];
+        pending.erase(pending.begin() + chosen);
+
+        // Cheapest vehicle, lowest index on ties so the result is deterministic
+        const Insertion* best{nullptr};
+        for (index_t v{0}; v < vCount; ++v)
+            if (const auto& o = options[call * vCount + v]; o && (!best || o->delta < best->delta))
+                best = &(*o);
+
+        // Keep it in the dummy if that's cheaper
+        if (!best || p.calls[call].costOfNotTransporting <= best->delta)
+            continue;
+
+        const auto ins = *best;
+        erase(dummy.calls, call);
+        dummy.bChanged = true;
+        applyInsertion(s[ins.vehicle].calls, ins);
+        s[ins.vehicle].bChanged = true;
+        index.assign(call, ins.vehicle);
+
+        // Only the changed vehicle needs to be reevaluated
+        buildSchedule(p, ins.vehicle, s[ins.vehicle].calls, schedules[ins.vehicle]);
+        updateOptions(ins.vehicle);
+    }
+
+    return s;
+}
+
+SolutionCached randomremoval(const Problem& p, SolutionCached s, unsigned int q, Random& ran) {
+    const auto& index = callIndex(s);
+    for (unsigned int i{0}; i < q && 0 < index.servedCount(); ++i) {
+        const auto call = index.servedCalls()[randomIndex(ran, index.servedCount())];
+        moveToDummy(s, index.vehicleOf(call), call);
+    }
+    return s;
+}
+
+SolutionCached worstremoval(const Problem& p, SolutionCached s, unsigned int q, Random& ran) {
+    constexpr double RANDOMNESS = 3.0;
+
+    const auto vCount = static_cast<index_t>(p.vehicles.size());
+    RouteSchedule schedule;
+    // (saving, call, vehicle) for every served call
+    std::vector<std::tuple<int, index_t, index_t>> savings;
+
+    const auto addSavings = [&](index_t v) {
+        const auto& route = s[v].calls;
+        buildSchedule(p, v, route, schedule);
+        for (std::size_t i{0}; i < route.size(); ++i) {
+            const auto j = static_cast<std::size_t>(std::find(route.begin() + i + 1, route.end(), route[i]) - route.begin());
+            if (j == route.size())
+                continue; // Delivery, already handled by its pickup
+            const auto saving = schedule.route().cost - removalSegment(p, schedule, i, j).cost;
+            savings.emplace_back(saving, route[i], v);
+        }
+    };
+    for (index_t v{0}; v < vCount; ++v)
+        addSavings(v);
+
+    for (unsigned int i{0}; i < q && !savings.empty(); ++i) {
+        std::sort(savings.begin(), savings.end(), std::greater{});
+        const auto [saving, call, vehicle] = savings[skewedIndex(savings.size(), RANDOMNESS, ran)];
+        moveToDummy(s, vehicle, call);
+
+        // Savings only change for the vehicle the call was taken out of
+        std::erase_if(savings, [v = vehicle](const auto& c){ return std::get<2>(c) == v; });
+        addSavings(vehicle);
+    }
+    return s;
+}
+
+SolutionCached shawremoval(const Problem& p, SolutionCached s, unsigned int q, Random& ran) {
+    constexpr double RANDOMNESS = 6.0;
+    // Samples to try before falling back to a scan for the most related call still in a vehicle
+    constexpr unsigned int MAX_ATTEMPTS = 10;
+
+    const auto& related{p.relatedness};
+    const auto& index = callIndex(s);
+    if (index.servedCount() == 0 || related.neighborCount() == 0)
+        return s;
+
+    std::vector<index_t> removed;
+    removed.reserve(q);
+    const auto remove = [&](index_t call) {
+        moveToDummy(s, index.vehicleOf(call), call);
+        removed.push_back(call);
+    };
+
+    // Start with a random call
+    remove(index.servedCalls()[randomIndex(ran, index.servedCount())]);
+
+    while (removed.size() < q && 0 < index.servedCount()) {
+        // Remove a call related to a random already removed call
+        const auto target = removed[randomIndex(ran, removed.size())];
+        std::optional<index_t> next{std::nullopt};
+        for (unsigned int attempt{0}; attempt < MAX_ATTEMPTS && !next; ++attempt)
+            if (const auto c = related.neighbor(target, skewedIndex(related.neighborCount(), RANDOMNESS, ran)); index.isServed(c))
+                next = c;
+        for (std::size_t rank{0}; !next && rank < related.neighborCount(); ++rank)
+            if (const auto c = related.neighbor(target, rank); index.isServed(c))
+                next = c;
+
+        remove(*next);
+    }
+    return s;
+}
+
+SolutionCached relocate(const Problem& p, SolutionCached s, Random& ran) {
+    const auto vOpt = randomVehicle(s, 4, ran);
+    if (!vOpt)
+        return s;
+    const auto v = *vOpt;
+    auto& route = s[v].calls;
+
+    RouteSchedule schedule;
+    buildSchedule(p, v, route, schedule);
+    auto bestCost = feasible(p, v, schedule.route()) ? schedule.route().cost : std::numeric_limits<int>::max();
+    std::optional<Route> best{std::nullopt};
+
+    for (std::size_t i{0}; i < route.size(); ++i) {
+        const auto call = route[i];
+        // Only handle each call once, at its pickup
+        if (std::find(route.begin(), route.begin() + i, call) != route.begin() + i)
+            continue;
+
+        auto without = route;
+        erase(without, call);
+        buildSchedule(p, v, without, schedule);
+        const auto ins = bestInsertion(p, schedule, call);
+        if (ins && schedule.route().cost + ins->delta < bestCost) {
+            bestCost = schedule.route().cost + ins->delta;
+            applyInsertion(without, *ins);
+            best = without;
+        }
+    }
+
+    if (best) {
+        route = *best;
+        s[v].bChanged = true;
+    }
+    return s;
+}
+
+SolutionCached oropt(const Problem& p, SolutionCached s, Random& ran) {
+    constexpr std::size_t MAX_SEGMENT = 3;
+
+    const auto vOpt = randomVehicle(s, 4, ran);
+    if (!vOpt)
+        return s;
+    const auto v = *vOpt;
+    auto& route = s[v].calls;
+    const auto n = route.size();
+
+    RouteSchedule schedule;
+    buildSchedule(p, v, route, schedule);
+    const auto& stops{schedule.stops};
+    const auto& prefix{schedule.prefix};
+    const auto& suffix{schedule.suffix};
+
+    // Index of the other stop of the same call
+    std::vector<std::size_t> partner(n);
+    for (std::size_t i{0}; i < n; ++i)
+        partner[i] = static_cast<std::size_t>(std::find_if(route.begin(), route.end(), [&, i](const auto& c){
+            return c == route[i] && &c != &route[i];
+        }) - route.begin());
+
+    // Best move as the three rotation points [first, middle, last) of the route
+    auto bestCost = feasible(p, v, schedule.route()) ? schedule.route().cost : std::numeric_limits<int>::max();
+    std::optional<std::array<std::size_t, 3>> best{std::nullopt};
+    const auto consider = [&](const Segment& candidate, std::array<std::size_t, 3> rotation) {
+        if (feasible(p, v, candidate) && candidate.cost < bestCost) {
+            bestCost = candidate.cost;
+            best = rotation;
+        }
+    };
+
+    for (std::size_t a{0}; a < n; ++a) {
+        auto segment = stops[a];
+        for (std::size_t length{1}; length <= MAX_SEGMENT && a + length <= n; ++length) {
+            if (1 < length)
+                segment = concat(p, v, segment, stops[a + length - 1]);
+            const auto end = a + length;
+            const auto inSegment = [&](std::size_t i){ return a <= i && i < end; };
+
+            // Move segment earlier, in front of stop b. Jumping over the pickup of a call delivered in the segment breaks precedence.
+            std::optional<Segment> skipped{std::nullopt};
+            for (auto b{a}; 0 < b--;) {
+                if (inSegment(partner[b]))
+                    break;
+                skipped = skipped ? concat(p, v, stops[b], *skipped) : stops[b];
+                const auto candidate = concat(p, v, concat(p, v, prefix[b], segment), *skipped);
+                consider(end < n ? concat(p, v, candidate, suffix[end]) : candidate, {b, a, end});
+            }
+
+            // Move segment later, after stop e. Jumping over the delivery of a call picked up in the segment breaks precedence.
+            skipped = std::nullopt;
+            for (auto e{end}; e < n; ++e) {
+                if (inSegment(partner[e]))
+                    break;
+                skipped = skipped ? concat(p, v, *skipped, stops[e]) : stops[e];
+                const auto candidate = concat(p, v, concat(p, v, prefix[a], *skipped), segment);
+                consider(e + 1 < n ? concat(p, v, candidate, suffix[e + 1]) : candidate, {a, end, e + 1});
+            }
+        }
+    }
+
+    if (best) {
+        const auto [first, middle, last] = *best;
+        std::rotate(route.begin() + first, route.begin() + middle, route.begin() + last);
+        s[v].bChanged = true;
+    }
+    return s;
+}
+
+namespace {
+// Replaces the route of v with its optimal order if that is cheaper
+void resequenceVehicle(const Problem& p, SolutionCached& s, index_t v) {
+    auto& route = s[v].calls;
+    if (route.size() < 4 || 2 * MAX_RESEQUENCE_CALLS < route.size())
+        return;
+
+    RouteSchedule schedule;
+    buildSchedule(p, v, route, schedule);
+    const auto bound = feasible(p, v, schedule.route()) ? schedule.route().cost : std::numeric_limits<int>::max();
+    if (auto sequence = optimalRoute(p, v, route, bound)) {
+        route = std::move(*sequence);
+        s[v].bChanged = true;
+    }
+}
+}
+
+SolutionCached resequence(const Problem& p, SolutionCached s, Random& ran) {
+    std::vector<index_t> vehicles;
+    vehicles.reserve(s.size());
+    for (index_t v{0}; v + 1 < s.size(); ++v)
+        if (4 <= s[v].calls.size() && s[v].calls.size() <= 2 * MAX_RESEQUENCE_CALLS)
+            vehicles.push_back(v);
+    if (!vehicles.empty())
+        resequenceVehicle(p, s, vehicles[randomIndex(ran, vehicles.size())]);
+    return s;
+}
+
+SolutionCached resequence(const Problem& p, SolutionCached s, const SolutionCached& reference) {
+    for (index_t v{0}; v + 1 < s.size(); ++v)
+        if (!(s[v].calls == reference[v].calls))
+            resequenceVehicle(p, s, v);
+    return s;
+}
+
 Solution scramble(const Problem& p, Solution s) {
     return s;
 }
 
-SolutionCached shuffle(SolutionCached s, std::default_random_engine& ran) {
+SolutionCached shuffle(SolutionCached s, Random& ran) {
     // Filter out empty cars:
     std::vector<index_t> nonEmptyCars;
     nonEmptyCars.reserve(s.size());
@@ -1140,7 +1321,7 @@ SolutionCached shuffle(SolutionCached s, std::default_random_engine& ran) {
             nonEmptyCars.push_back(i);
 
     // Shuffle non-empty car
-    const auto carId = nonEmptyCars.at(ran() % nonEmptyCars.size());
+    const auto carId = nonEmptyCars.at(randomIndex(ran, nonEmptyCars.size()));
     auto& car = s.at(carId).calls;
     std::shuffle(car.begin(), car.end(), ran);
     s.at(carId).bChanged = true;
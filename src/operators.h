@@ -4,29 +4,28 @@
 #include "problem.h"
 #include <utility>
 #include <type_traits>
-#include <random>
+#include "random.h"
+
+class ThreadPool;
 
 namespace op {
 
 /// Legacy operators:
 // 2-exchange operator
-Solution ex2(Solution s);
-Solution ex2(Solution s, std::default_random_engine& engine);
-SolutionCached ex2(SolutionCached s, std::default_random_engine& engine);
-SolutionComp ex2_comp(SolutionComp s);
-bool exchance(std::vector<int>& c1, std::vector<int>& c2);
+Solution ex2(Solution s, Random& engine);
+SolutionCached ex2(SolutionCached s, Random& engine);
+SolutionComp ex2_comp(SolutionComp s, Random& engine);
+bool exchance(std::vector<int>& c1, std::vector<int>& c2, Random& engine);
 
 // 3-exchange operator
-Solution ex3(Solution s);
-Solution ex3(Solution s, std::default_random_engine& engine);
-SolutionCached ex3(SolutionCached s, std::default_random_engine& engine);
-SolutionComp ex3_comp(SolutionComp s);
+Solution ex3(Solution s, Random& engine);
+SolutionCached ex3(SolutionCached s, Random& engine);
+SolutionComp ex3_comp(SolutionComp s, Random& engine);
 
 // 1-reinsert operator
-Solution ins1(Solution s);
-Solution ins1(Solution s, std::default_random_engine& engine);
-SolutionCached ins1(SolutionCached s, std::default_random_engine& engine);
-SolutionComp ins1_comp(SolutionComp s);
+Solution ins1(Solution s, Random& engine);
+SolutionCached ins1(SolutionCached s, Random& engine);
+SolutionComp ins1_comp(SolutionComp s, Random& engine);
 
 
 /// Custom operators:
@@ -36,13 +35,13 @@ SolutionComp ins1_comp(SolutionComp s);
  * @param s Previous solution
  * @return New (maybe) feasible solution
  */
-Solution fesins(const Problem& p, Solution s);
-SolutionCached fesins(const Problem& p, SolutionCached s, std::default_random_engine& engine);
+Solution fesins(const Problem& p, Solution s, Random& engine);
+SolutionCached fesins(const Problem& p, SolutionCached s, Random& engine);
 
 /**
  * @brief Like fesins, but inserts into random car that can take call instead of the one with largest capacity.
  */
-SolutionCached validins(const Problem& p, SolutionCached s, std::default_random_engine& engine);
+SolutionCached validins(const Problem& p, SolutionCached s, Random& engine);
 
 /**
  * @brief time-window reorder
@@ -51,15 +50,17 @@ SolutionCached validins(const Problem& p, SolutionCached s, std::default_random_
  * @param s 
  * @return Solution 
  */
-Solution freorder(const Problem& p, Solution s);
-SolutionCached freorder(const Problem& p, SolutionCached s, std::default_random_engine& engine);
+Solution freorder(const Problem& p, Solution s, Random& engine);
+SolutionCached freorder(const Problem& p, SolutionCached s, Random& engine);
 
 /**
  * @brief Multi-threading shuffle
- * Uses multiple threads to simultaneously generate a bunch of
- * random solutions and chooses the most promising looking one.
+ * Generates a bunch of random solutions at the same time on the
+ * thread pool and chooses the most promising looking one.
+ * Candidates are seeded from engine, and without a pool they
+ * are generated one after another.
  */
-Solution multishuffle(const Problem& p, Solution s);
+Solution multishuffle(const Problem& p, Solution s, Random& engine, ThreadPool* pool = nullptr);
 
 /**
  * @brief Moves from car to dummy car
@@ -68,25 +69,92 @@ Solution multishuffle(const Problem& p, Solution s);
  * @param s 
  * @return Solution 
  */
-Solution backinsert(const Problem& p, Solution s);
-SolutionCached backinsert(const Problem& p, SolutionCached s, std::default_random_engine& engine);
+Solution backinsert(const Problem& p, Solution s, Random& engine);
+SolutionCached backinsert(const Problem& p, SolutionCached s, Random& engine);
 
 /**
  * @brief Runs backinsert a random amount of times
  */
-SolutionCached multibackinsert(const Problem& p, SolutionCached s, std::default_random_engine& engine);
+SolutionCached multibackinsert(const Problem& p, SolutionCached s, Random& engine);
 
 /**
  * @brief 1-insert but takes random from dummy and randomly places it into least expensive car.
  */
-SolutionCached priceinsert(const Problem& p, SolutionCached s, std::default_random_engine& engine);
+SolutionCached priceinsert(const Problem& p, SolutionCached s, Random& engine);
+
+/**
+ * @brief Regret-k insertion
+ * Repeatedly finds the cheapest feasible position in every compatible vehicle for
+ * each call in the dummy, and inserts the call with the highest regret value
+ * (how much is lost by not inserting it into its best vehicle) first.
+ * Calls that are cheaper to leave in the dummy stay there.
+ * @param k Number of best vehicles to consider in the regret value. With k = 1 it becomes
+ * greedy insertion, where the call with the largest saving is inserted first.
+ * @param pool Optional pool used to evaluate the vehicles in parallel. Gives the same result as without.
+ */
+SolutionCached regretinsert(const Problem& p, SolutionCached s, unsigned int k = 2, ThreadPool* pool = nullptr);
+
+/// Ruin and recreate destroy operators:
+// Each of these moves q calls out of their vehicles and into the dummy,
+// and is meant to be followed by a repair operator like regretinsert.
+
+/**
+ * @brief Removes q random calls
+ */
+SolutionCached randomremoval(const Problem& p, SolutionCached s, unsigned int q, Random& ran);
+
+/**
+ * @brief Removes q calls that contribute the most to the cost of their vehicle
+ * Randomized like in Ropke & Pisinger (2006) so it doesn't always remove the same calls.
+ */
+SolutionCached worstremoval(const Problem& p, SolutionCached s, unsigned int q, Random& ran);
+
+/**
+ * @brief Shaw removal
+ * Removes a random call and then q - 1 calls related to the already removed ones,
+ * where related calls are close in distance, time windows, size and which vehicles can take them.
+ * Related calls are sampled from the precomputed Problem::relatedness.
+ */
+SolutionCached shawremoval(const Problem& p, SolutionCached s, unsigned int q, Random& ran);
+
+/// Intra-route operators:
+// Both pick a random vehicle and apply the best improving move within its route,
+// with every candidate evaluated in constant time from the cached route schedule.
+
+/**
+ * @brief Relocate
+ * Takes each call out of the route and reinserts its pickup and delivery at
+ * their cheapest feasible positions, keeping the best improvement.
+ */
+SolutionCached relocate(const Problem& p, SolutionCached s, Random& ran);
+
+/**
+ * @brief Or-opt
+ * Moves a segment of up to three consecutive stops to another place in the route,
+ * never moving a pickup past its delivery or the other way around.
+ */
+SolutionCached oropt(const Problem& p, SolutionCached s, Random& ran);
+
+/**
+ * @brief Exact re-sequencing
+ * Replaces the route of a random vehicle with the optimal order of its calls.
+ * Only vehicles with at most MAX_RESEQUENCE_CALLS calls are considered.
+ */
+SolutionCached resequence(const Problem& p, SolutionCached s, Random& ran);
+
+/**
+ * @brief Exact re-sequencing of every route that differs from reference
+ * Meant as intensification of a new best solution, where only the routes
+ * changed since the previous best can have become badly ordered.
+ */
+SolutionCached resequence(const Problem& p, SolutionCached s, const SolutionCached& reference);
 
 Solution scramble(const Problem& p, Solution s);
 
 /**
  * @brief Literally just shuffles a car
  */
-SolutionCached shuffle(SolutionCached s, std::default_random_engine& engine);
+SolutionCached shuffle(SolutionCached s, Random& engine);
 
 
 // Fuck yeah concepts!
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <utility>
 #include <numeric>
+#include <cmath>
 
 std::vector<std::string_view> split(const std::string_view& str, char c) {
     std::vector<std::string_view> views;
@@ -64,6 +65,9 @@ Result<Problem, std::runtime_error> load(const std::string& path) {
     std::size_t callCount{0};
     ss = std::stringstream{str};
     ss >> callCount;
+    // Routes store calls as index_t, so make sure they fit
+    if (std::numeric_limits<index_t>::max() < callCount)
+        return std::runtime_error{"Call count exceeds index type"};
 
     // Vehicle calls
     if (next()) return std::runtime_error{"End of file"};
@@ -124,78 +128,295 @@ Result<Problem, std::runtime_error> load(const std::string& path) {
         };
     }
 
+    buildLookupTables(p);
+    buildRelatedness(p);
+
     return p;
 }
 
-Solution toNestedList(const SolutionComp& s) {
-    Solution out;
-    std::size_t beg{0};
-    for (index_t end{0}; end <= s.size(); ++end) { // Allow for one past end as this copies the range before the end
-        if (end == s.size() || s[end] == -1) {
-            out.push_back(std::vector<int>{s.begin() + beg, s.begin() + end});
+void buildLookupTables(Problem& p) {
+    const auto vCount{p.vehicles.size()}, cCount{p.calls.size()}, n{p.nodeCount};
+
+    p.travelTimes.assign(vCount * n * n, MISSING_TRIP_TIME);
+    p.travelCosts.assign(vCount * n * n, 0);
+    for (const auto& trip : p.trips) {
+        if (vCount <= trip.vehicleIndex || n <= trip.origin || n <= trip.destination)
+            continue;
+        const auto i = (trip.vehicleIndex * n + trip.origin) * n + trip.destination;
+        p.travelTimes[i] = trip.time;
+        p.travelCosts[i] = trip.cost;
+    }
+
+    p.vehicleCallTable.assign(vCount * cCount, VehicleCall{});
+    p.compatible.assign(vCount * cCount, 0);
+    for (index_t v{0}; v < vCount; ++v) {
+        for (const auto c : p.vehicles[v].availableCalls) {
+            const auto it = p.vehicleCalls.find({v, c});
+            if (cCount <= c || it == p.vehicleCalls.end())
+                continue;
+            p.vehicleCallTable[v * cCount + c] = it->second;
+            p.compatible[v * cCount + c] = 1;
+        }
+    }
+}
+
+void buildRelatedness(Problem& p) {
+    // Weights from Ropke & Pisinger (2006) of distance, time, size and vehicle compatibility
+    constexpr double DISTANCE_WEIGHT = 9.0, TIME_WEIGHT = 3.0, SIZE_WEIGHT = 2.0, VEHICLE_WEIGHT = 5.0;
+
+    const auto n{p.calls.size()}, vCount{p.vehicles.size()};
+    auto& r{p.relatedness};
+    r.callCount = n;
+    r.neighbors.clear();
+    if (n < 2)
+        return;
 
-            beg = end + 1;
+    // Travel time between nodes averaged over every vehicle
+    std::vector<double> distances(p.nodeCount * p.nodeCount, 0.0);
+    double maxDistance{1.0};
+    for (index_t a{0}; a < p.nodeCount; ++a) {
+        for (index_t b{0}; b < p.nodeCount; ++b) {
+            double sum{0.0};
+            for (index_t v{0}; v < vCount; ++v)
+                sum += std::min(p.travelTime(v, a, b), MISSING_TRIP_TIME / 2);
+            auto& d = distances[a * p.nodeCount + b];
+            d = vCount ? sum / vCount : 0.0;
+            maxDistance = std::max(maxDistance, d);
         }
     }
+    int maxWindow{1}, maxSize{1};
+    for (const auto& c : p.calls) {
+        maxWindow = std::max(maxWindow, c.upperTimewindowDelivery);
+        maxSize = std::max(maxSize, c.size);
+    }
+    std::vector<int> vehicleCounts(n, 0);
+    for (index_t c{0}; c < n; ++c)
+        for (index_t v{0}; v < vCount; ++v)
+            vehicleCounts[c] += p.canTake(v, c);
+
+    // Relatedness with every term normalized to [0, 1]. Lower is more related.
+    std::vector<double> raw(n * n, 0.0);
+    for (index_t i{0}; i < n; ++i) {
+        const auto& a{p.calls[i]};
+        for (index_t j{0}; j < n; ++j) {
+            if (i == j)
+                continue;
+            const auto& b{p.calls[j]};
+            const auto distance = (distances[a.origin * p.nodeCount + b.origin] + distances[a.destination * p.nodeCount + b.destination]) / (2 * maxDistance);
+            const auto time = static_cast<double>(std::abs(a.lowerTimewindowPickup - b.lowerTimewindowPickup) + std::abs(a.lowerTimewindowDelivery - b.lowerTimewindowDelivery)) / (2 * maxWindow);
+            const auto size = static_cast<double>(std::abs(a.size - b.size)) / maxSize;
+            int shared{0};
+            for (index_t v{0}; v < vCount; ++v)
+                shared += p.canTake(v, i) && p.canTake(v, j);
+            const auto vehicles = 1.0 - static_cast<double>(shared) / std::max(1, std::min(vehicleCounts[i], vehicleCounts[j]));
+
+            auto& value = raw[i * n + j];
+            value = DISTANCE_WEIGHT * distance + TIME_WEIGHT * time + SIZE_WEIGHT * size + VEHICLE_WEIGHT * vehicles;
+        }
+    }
+
+    // Sort neighbors
+    r.neighbors.resize(n * (n - 1));
+    for (index_t i{0}; i < n; ++i) {
+        const auto row = r.neighbors.begin() + i * (n - 1);
+        std::size_t k{0};
+        for (index_t j{0}; j < n; ++j)
+            if (j != i)
+                row[k++] = j;
+        std::stable_sort(row, row + (n - 1), [&](index_t a, index_t b){ return raw[i * n + a] < raw[i * n + b]; });
+    }
+}
+
+Solution toNestedList(const SolutionComp& s) {
+    Solution out;
+    toNestedList(s, out);
     return out;
 }
 
+void toNestedList(const SolutionComp& s, Solution& out) {
+    std::size_t i{0};
+    for (const auto route : routes(s)) {
+        if (out.size() <= i)
+            out.emplace_back();
+        out[i].assign(route.begin(), route.end());
+        ++i;
+    }
+    out.resize(i);
+}
+
+void CallIndex::build(const std::vector<VehicleSolution>& routes) {
+    std::size_t stops{0};
+    for (const auto& r : routes)
+        stops += r.calls.size();
+    callCount = static_cast<index_t>(stops / 2);
+    dummy = static_cast<index_t>(routes.size() - 1);
+    served = 0;
+
+    const std::size_t n{callCount};
+    data.assign(3 * n, 0);
+    for (index_t v{0}; v < routes.size(); ++v)
+        for (const auto call : routes[v].calls)
+            data[call] = v;
+
+    // Served calls from the front, unserved from the back
+    std::size_t back{n};
+    for (index_t call{0}; call < callCount; ++call) {
+        const auto pos = data[call] != dummy ? served++ : --back;
+        data[n + pos] = call;
+        data[2 * n + call] = static_cast<index_t>(pos);
+    }
+}
+
+void CallIndex::build(const std::vector<VehicleSolution>& routes, std::span<const index_t> order) {
+    build(routes);
+    const std::size_t n{callCount};
+    for (std::size_t pos{0}; pos < n && pos < order.size(); ++pos) {
+        data[n + pos] = order[pos];
+        data[2 * n + order[pos]] = static_cast<index_t>(pos);
+    }
+}
+
+void CallIndex::swapCalls(std::size_t i, std::size_t j) {
+    const std::size_t n{callCount};
+    const auto a = data[n + i];
+    const auto b = data[n + j];
+    data[n + i] = b;
+    data[n + j] = a;
+    data[2 * n + a] = static_cast<index_t>(j);
+    data[2 * n + b] = static_cast<index_t>(i);
+}
+
+void CallIndex::assign(index_t call, index_t vehicle) {
+    const bool bWasServed = isServed(call);
+    data[call] = vehicle;
+    const bool bServed = isServed(call);
+    if (bWasServed == bServed)
+        return;
+
+    const auto pos = data[2 * std::size_t{callCount} + call];
+    if (bServed)
+        swapCalls(pos, served++);
+    else
+        swapCalls(pos, --served);
+}
+
+bool CallIndex::consistent(const std::vector<VehicleSolution>& routes) const {
+    CallIndex fresh;
+    fresh.build(routes);
+    if (fresh.callCount != callCount || fresh.served != served || fresh.dummy != dummy)
+        return false;
+    for (index_t call{0}; call < callCount; ++call) {
+        const auto pos = data[2 * std::size_t{callCount} + call];
+        if (fresh.data[call] != data[call] || data[callCount + pos] != call || (pos < served) != isServed(call))
+            return false;
+    }
+    return true;
+}
+
+CallIndex& callIndex(SolutionCached& s) {
+    if (s.index.empty())
+        s.index.build(s);
+    return s.index;
+}
+
 SolutionCached toCachedSolution(const Solution& s) {
     SolutionCached out;
-    out.reserve(s.size());
-    std::transform(s.begin(), s.end(), std::back_inserter(out), [](const auto& l){
-        return VehicleSolution{ .calls = l };
-    });
+    toCachedSolution(s, out);
     return out;
 }
 
-std::vector<int> fromNestedList(const Solution& list) {
-    std::vector<int> out;
+SolutionCached toCachedSolution(const SolutionComp& s) {
+    SolutionCached out;
+    toCachedSolution(s, out);
+    return out;
+}
+
+// Assigns a route into a cached vehicle solution, marking it as changed
+template <typename T>
+void assignRoute(VehicleSolution& vehicle, const T& route) {
+    vehicle.calls.clear();
+    vehicle.calls.reserve(route.size());
+    for (const auto v : route)
+        vehicle.calls.push_back(static_cast<index_t>(v));
+    vehicle.cost = std::nullopt;
+    vehicle.bChanged = true;
+}
+
+void toCachedSolution(const Solution& s, SolutionCached& out) {
+    out.index.clear();
+    out.resize(s.size());
+    for (std::size_t i{0}; i < s.size(); ++i)
+        assignRoute(out[i], s[i]);
+}
+
+void toCachedSolution(const SolutionComp& s, SolutionCached& out) {
+    out.index.clear();
+    std::size_t i{0};
+    for (const auto route : routes(s)) {
+        if (out.size() <= i)
+            out.emplace_back();
+        assignRoute(out[i], route);
+        ++i;
+    }
+    out.resize(i);
+}
+
+/**
+ * @brief Flattens routes into a single list separated by a separator value.
+ * @param offset Added to every call (1 for the one-indexed output format)
+ */
+template <typename T, typename F>
+void flatten(const T& list, F&& getRoute, int offset, int separator, std::vector<int>& out) {
+    out.clear();
     out.reserve(
-        std::accumulate(list.begin(), list.end(), std::size_t{0}, [](const auto& a, const auto& b){
-            return a + b.size() + 1;
+        std::accumulate(list.begin(), list.end(), std::size_t{0}, [&](const auto& a, const auto& b){
+            return a + getRoute(b).size() + 1;
         })
     );
     for (std::size_t i{0}; i < list.size(); ++i) {
-        auto inner = list.at(i);
-        for (const auto& v : inner)
-            out.push_back(v+1);
+        for (const auto& v : getRoute(list[i]))
+            out.push_back(v + offset);
         if (i < list.size() - 1)
-            out.push_back(0);
+            out.push_back(separator);
     }
+}
+
+std::vector<int> fromNestedList(const Solution& list) {
+    std::vector<int> out;
+    fromNestedList(list, out);
     return out;
 }
 
 std::vector<int> fromNestedList(const SolutionCached& list) {
     std::vector<int> out;
-    out.reserve(
-        std::accumulate(list.begin(), list.end(), std::size_t{0}, [](const auto& a, const auto& b){
-            return a + b.calls.size() + 1;
-        })
-    );
-    for (std::size_t i{0}; i < list.size(); ++i) {
-        auto inner = list.at(i).calls;
-        for (const auto& v : inner)
-            out.push_back(v+1);
-        if (i < list.size() - 1)
-            out.push_back(0);
-    }
+    fromNestedList(list, out);
     return out;
 }
 
 SolutionComp fromNestedListZeroIndexed(const Solution& list) {
-    std::vector<int> out;
-    out.reserve(
-        std::accumulate(list.begin(), list.end(), std::size_t{0}, [](const auto& a, const auto& b){
-            return a + b.size() + 1;
-        })
-    );
-    for (std::size_t i{0}; i < list.size(); ++i) {
-        auto inner = list.at(i);
-        for (const auto& v : inner)
-            out.push_back(v);
-        if (i < list.size() - 1)
-            out.push_back(-1);
-    }
+    SolutionComp out;
+    fromNestedListZeroIndexed(list, out);
     return out;
+}
+
+SolutionComp fromNestedListZeroIndexed(const SolutionCached& list) {
+    SolutionComp out;
+    fromNestedListZeroIndexed(list, out);
+    return out;
+}
+
+void fromNestedList(const Solution& list, std::vector<int>& out) {
+    flatten(list, [](const auto& l) -> const auto& { return l; }, 1, 0, out);
+}
+
+void fromNestedList(const SolutionCached& list, std::vector<int>& out) {
+    flatten(list, [](const auto& l) -> const auto& { return l.calls; }, 1, 0, out);
+}
+
+void fromNestedListZeroIndexed(const Solution& list, SolutionComp& out) {
+    flatten(list, [](const auto& l) -> const auto& { return l; }, 0, -1, out);
+}
+
+void fromNestedListZeroIndexed(const SolutionCached& list, SolutionComp& out) {
+    flatten(list, [](const auto& l) -> const auto& { return l.calls; }, 0, -1, out);
 }
\ No newline at end of file
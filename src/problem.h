@@ -6,6 +6,8 @@
 #include <limits>
 #include <map>
 #include <optional>
+#include <span>
+#include "smallvector.h"
 
 // Maybe monad / neither implementation based on https://github.com/LoopPerfect/neither and std::optional
 template <typename T, typename E = std::exception>
@@ -67,17 +69,55 @@ struct VehicleCall {
     int destNodeTime;
     int destNodeCosts;
 };
+/**
+ * @brief Precomputed relatedness between every pair of calls
+ * Every call has a list of the other calls sorted from most to least
+ * related, so operators can pick the n'th most related call in constant time.
+ */
+struct Relatedness {
+    std::size_t callCount{0};
+    std::vector<index_t> neighbors; // [call][rank], excluding the call itself
+
+    // The rank'th most related call to a. rank < callCount - 1
+    index_t neighbor(index_t a, std::size_t rank) const { return neighbors[a * (callCount - 1) + rank]; }
+    std::size_t neighborCount() const { return callCount - 1; }
+};
+
 struct Problem {
     std::size_t nodeCount;
     std::vector<Vehicle> vehicles;
     std::vector<Call> calls;
     std::vector<Trip> trips;
     std::map<std::pair<index_t, index_t>, VehicleCall> vehicleCalls; // vehicle index, call index
+
+    // Dense lookup tables built from trips and vehicleCalls when loading,
+    // so the incremental evaluators can do constant time lookups.
+    std::vector<int> travelTimes; // [vehicle][origin][destination]
+    std::vector<int> travelCosts; // [vehicle][origin][destination]
+    std::vector<VehicleCall> vehicleCallTable; // [vehicle][call]
+    std::vector<uint8_t> compatible; // [vehicle][call], vehicle can take call and has a vehicle call entry
+    Relatedness relatedness;
+
+    int travelTime(index_t v, index_t a, index_t b) const { return travelTimes[(v * nodeCount + a) * nodeCount + b]; }
+    int travelCost(index_t v, index_t a, index_t b) const { return travelCosts[(v * nodeCount + a) * nodeCount + b]; }
+    const VehicleCall& vehicleCall(index_t v, index_t c) const { return vehicleCallTable[v * calls.size() + c]; }
+    bool canTake(index_t v, index_t c) const { return compatible[v * calls.size() + c]; }
 };
 
+/// Travel time used in the dense tables for trips missing from the input. Large enough to break any time window.
+constexpr int MISSING_TRIP_TIME = std::numeric_limits<int>::max() / 4;
+
 using Solution = std::vector<std::vector<int>>;
+
+/** Route of a single vehicle
+ * Calls are stored as index_t, and most routes are short enough
+ * to fit in the inline buffer, so copying a route usually doesn't allocate.
+ * Only long routes (like the dummy vehicle) spill over to the heap.
+ */
+using Route = SmallVector<index_t, 16>;
+
 struct VehicleSolution {
-    std::vector<int> calls;
+    Route calls;
     std::optional<int> cost{std::nullopt};
     bool bChanged{true};
 
@@ -91,7 +131,66 @@ struct VehicleSolution {
     bool infeasible() const { return !bChanged && !cost; }
     bool feasible() const { return !bChanged && cost; }
 };
-using SolutionCached = std::vector<VehicleSolution>;
+
+/**
+ * @brief Which vehicle every call of a solution is in
+ * Calls are kept in a single dense array with the served calls first and
+ * the calls in the dummy after, so a random call, a random served call or
+ * a random unserved call can be drawn in constant time. Moving a call to
+ * another vehicle only swaps it across the boundary, which is constant as well.
+ * Everything is stored in one buffer so copying a solution only costs one
+ * extra allocation.
+ */
+class CallIndex {
+public:
+    bool empty() const { return callCount == 0; }
+    std::size_t size() const { return callCount; }
+    std::size_t servedCount() const { return served; }
+    std::size_t unservedCount() const { return callCount - served; }
+
+    index_t vehicleOf(index_t call) const { return data[call]; }
+    bool isServed(index_t call) const { return data[call] != dummy; }
+    /// Served calls, in no particular order
+    std::span<const index_t> servedCalls() const { return {data.data() + callCount, served}; }
+    /// Calls in the dummy, in no particular order
+    std::span<const index_t> unservedCalls() const { return {data.data() + callCount + served, unservedCount()}; }
+
+    /// Every call with the served ones first, in the order sampling sees them
+    std::span<const index_t> order() const { return {data.data() + callCount, callCount}; }
+
+    /// Rebuilds the index from routes where the last route is the dummy
+    void build(const std::vector<VehicleSolution>& routes);
+    /// Rebuilds the index with the calls in a given order, as returned by order()
+    void build(const std::vector<VehicleSolution>& routes, std::span<const index_t> order);
+    void clear() { data.clear(); callCount = served = dummy = 0; }
+    /// Records that call has been moved into vehicle
+    void assign(index_t call, index_t vehicle);
+    /// Whether the index describes routes
+    bool consistent(const std::vector<VehicleSolution>& routes) const;
+
+private:
+    // [0, n): vehicle of call, [n, 2n): calls with the served ones first, [2n, 3n): position of call in [n, 2n)
+    std::vector<index_t> data;
+    index_t callCount{0};
+    index_t served{0};
+    index_t dummy{0};
+
+    void swapCalls(std::size_t i, std::size_t j);
+};
+
+/**
+ * @brief Cached solution, one route per vehicle with the dummy last
+ * The call index is built on first use by callIndex(). Anything moving calls
+ * between vehicles has to either keep it up to date or clear it.
+ */
+struct SolutionCached : std::vector<VehicleSolution> {
+    using std::vector<VehicleSolution>::vector;
+
+    CallIndex index;
+};
+
+/// Call index of the solution, built if it isn't already
+CallIndex& callIndex(SolutionCached& s);
 
 /** Compact memory layout solution representation
  * Since it's a one dimensional vector the memory representation
@@ -114,6 +213,10 @@ inline index_t stoi(const std::string_view& sv) {
 }
 
 Result<Problem, std::runtime_error> load(const std::string& path);
+// Fills in the dense lookup tables of a problem. (Called by load)
+void buildLookupTables(Problem& p);
+// Computes the related calls of every call. Needs the lookup tables. (Called by load)
+void buildRelatedness(Problem& p);
 
 
 template <std::size_t I>
@@ -134,10 +237,23 @@ Solution toNestedList(const int (&a)[I]) {
 
 Solution toNestedList(const SolutionComp& s);
 SolutionCached toCachedSolution(const Solution& s);
+SolutionCached toCachedSolution(const SolutionComp& s);
 
 std::vector<int> fromNestedList(const Solution& list);
 std::vector<int> fromNestedList(const SolutionCached& list);
 SolutionComp fromNestedListZeroIndexed(const Solution& list);
+SolutionComp fromNestedListZeroIndexed(const SolutionCached& list);
+
+/// In-place conversions
+// These write into a caller provided buffer, reusing whatever capacity
+// it already has, so converting back and forth in a loop doesn't allocate.
+void toNestedList(const SolutionComp& s, Solution& out);
+void toCachedSolution(const Solution& s, SolutionCached& out);
+void toCachedSolution(const SolutionComp& s, SolutionCached& out);
+void fromNestedList(const Solution& list, std::vector<int>& out);
+void fromNestedList(const SolutionCached& list, std::vector<int>& out);
+void fromNestedListZeroIndexed(const Solution& list, SolutionComp& out);
+void fromNestedListZeroIndexed(const SolutionCached& list, SolutionComp& out);
 
 // https://stackoverflow.com/questions/60151514/using-stdvector-as-view-on-to-raw-memory
 template<typename T>
@@ -155,4 +271,50 @@ public:
    auto begin() const noexcept { return ptr_; }
    auto end() noexcept { return ptr_ + len_; }
    auto end() const noexcept { return ptr_ + len_; }
-};
\ No newline at end of file
+};
+
+/**
+ * @brief Non-owning view over the routes of a compact solution
+ * Iterates the -1 separated routes of a SolutionComp as array_views,
+ * so a compact solution can be walked route by route without first
+ * converting it into a nested list.
+ * @tparam T int or const int
+ */
+template <typename T>
+class CompRoutes {
+    T* data_;
+    std::size_t size_;
+public:
+    class iterator {
+        T* data_;
+        std::size_t size_, begin_, end_;
+
+        std::size_t findEnd(std::size_t from) const noexcept {
+            while (from < size_ && data_[from] != -1)
+                ++from;
+            return from;
+        }
+    public:
+        iterator(T* data, std::size_t size, std::size_t begin) noexcept
+            : data_{data}, size_{size}, begin_{begin}, end_{begin <= size ? findEnd(begin) : begin} {}
+
+        array_view<T> operator*() const noexcept { return {data_ + begin_, end_ - begin_}; }
+        iterator& operator++() noexcept {
+            begin_ = end_ + 1;
+            end_ = begin_ <= size_ ? findEnd(begin_) : begin_;
+            return *this;
+        }
+        bool operator==(const iterator& rhs) const noexcept { return begin_ == rhs.begin_; }
+        // Offset of the current route into the compact solution
+        std::size_t offset() const noexcept { return begin_; }
+    };
+
+    CompRoutes(T* data, std::size_t size) noexcept : data_{data}, size_{size} {}
+
+    iterator begin() const noexcept { return {data_, size_, 0}; }
+    // One past the separator that would follow the last route
+    iterator end() const noexcept { return {data_, size_, size_ + 1}; }
+};
+
+inline CompRoutes<int> routes(SolutionComp& s) { return {s.data(), s.size()}; }
+inline CompRoutes<const int> routes(const SolutionComp& s) { return {s.data(), s.size()}; }
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "random.h"
+
+void Xoshiro256pp::seed(std::uint64_t seed) {
+    // splitmix64
+    for (auto& word : s) {
+        auto z = (seed += 0x9e3779b97f4a7c15);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        word = z ^ (z >> 31);
+    }
+}
+
+void Xoshiro256pp::fill(std::span<result_type> out) {
+    auto s0 = s[0], s1 = s[1], s2 = s[2], s3 = s[3];
+    for (auto& x : out) {
+        x = rotl(s0 + s3, 23) + s0;
+        const auto t = s1 << 17;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = rotl(s3, 45);
+    }
+    s = {s0, s1, s2, s3};
+}
+
+void Xoshiro256pp::jump(const std::array<std::uint64_t, 4>& polynomial) {
+    std::array<std::uint64_t, 4> jumped{0, 0, 0, 0};
+    for (const auto word : polynomial)
+        for (int b{0}; b < 64; ++b) {
+            if (word & (std::uint64_t{1} << b))
+                for (std::size_t i{0}; i < jumped.size(); ++i)
+                    jumped[i] ^= s[i];
+            (*this)();
+        }
+    s = jumped;
+}
+
+void Xoshiro256pp::jump() {
+    jump({0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c});
+}
+
+void Xoshiro256pp::longJump() {
+    jump({0x76e15d3efefdcbbf, 0xc5004e441c522fb3, 0x77710069854ee241, 0x39109bb02acbe635});
+}
+
+std::ostream& operator<<(std::ostream& os, const Xoshiro256pp& g) {
+    return os << g.s[0] << ' ' << g.s[1] << ' ' << g.s[2] << ' ' << g.s[3];
+}
+
+std::istream& operator>>(std::istream& is, Xoshiro256pp& g) {
+    std::array<std::uint64_t, 4> s;
+    if (is >> s[0] >> s[1] >> s[2] >> s[3])
+        g.s = s;
+    return is;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <span>
+
+/**
+ * @brief xoshiro256++ pseudo random number generator
+ * 256 bits of state, 64 bit output and a handful of instructions per number,
+ * several times faster than the linear congruential std::default_random_engine
+ * and without its poor low bits. Meets the requirements of a
+ * UniformRandomBitGenerator, so it works with the standard algorithms
+ * (std::shuffle and the like), and streams its state like the standard engines.
+ * @see https://prng.di.unimi.it/
+ */
+class Xoshiro256pp {
+public:
+    using result_type = std::uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    /// Fills the state from seed with splitmix64, so nearby seeds still give unrelated states
+    explicit Xoshiro256pp(std::uint64_t seed = 0) { this->seed(seed); }
+    void seed(std::uint64_t seed);
+
+    result_type operator()() {
+        const auto result = rotl(s[0] + s[3], 23) + s[0];
+        const auto t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    /**
+     * @brief Batched generation, same numbers as out.size() calls in a row
+     * Keeps the state in registers for the whole batch, for kernels that
+     * want a block of random numbers up front instead of one at a time.
+     */
+    void fill(std::span<result_type> out);
+
+    /// Advances the state by 2^128 numbers. Every jump starts a stream that won't overlap the others for 2^128 numbers.
+    void jump();
+    /// Advances the state by 2^192 numbers, for splitting up sets of streams made by jump
+    void longJump();
+
+    friend bool operator==(const Xoshiro256pp&, const Xoshiro256pp&) = default;
+    friend std::ostream& operator<<(std::ostream& os, const Xoshiro256pp& g);
+    friend std::istream& operator>>(std::istream& is, Xoshiro256pp& g);
+
+private:
+    static constexpr result_type rotl(result_type x, int k) { return (x << k) | (x >> (64 - k)); }
+    void jump(const std::array<std::uint64_t, 4>& polynomial);
+
+    std::array<std::uint64_t, 4> s;
+};
+
+/**
+ * Generator used throughout the program. Any generator with 64 bit output,
+ * jump, fill and stream operators can be swapped in here.
+ */
+using Random = Xoshiro256pp;
+
+/**
+ * @brief Uniform integer in [0, n)
+ * Lemire's multiply-shift method: one multiplication instead of a division,
+ * and without the bias of ran() % n. n has to be in [1, 2^32).
+ * @see https://arxiv.org/abs/1805.10941
+ */
+template <typename Generator, typename Int>
+Int randomIndex(Generator& g, Int n) {
+    const auto range = static_cast<std::uint32_t>(n);
+    auto m = static_cast<std::uint64_t>(static_cast<std::uint32_t>(g() >> 32)) * range;
+    if (static_cast<std::uint32_t>(m) < range) {
+        // Reject the few values that would make some outcomes more likely
+        const auto threshold = static_cast<std::uint32_t>(-range) % range;
+        while (static_cast<std::uint32_t>(m) < threshold)
+            m = static_cast<std::uint64_t>(static_cast<std::uint32_t>(g() >> 32)) * range;
+    }
+    return static_cast<Int>(m >> 32);
+}
+
+/// Uniform real in [0, 1), with all 53 bits of a double random
+template <typename Generator>
+double randomUnit(Generator& g) {
+    return static_cast<double>(g() >> 11) * 0x1.0p-53;
+}
+
+/// Batch of uniform reals in [0, 1)
+template <typename Generator>
+void randomUnits(Generator& g, std::span<double> out) {
+    std::array<typename Generator::result_type, 64> raw;
+    for (std::size_t begin{0}; begin < out.size(); begin += raw.size()) {
+        const auto count = std::min(raw.size(), out.size() - begin);
+        g.fill(std::span{raw.data(), count});
+        for (std::size_t i{0}; i < count; ++i)
+            out[begin + i] = static_cast<double>(raw[i] >> 11) * 0x1.0p-53;
+    }
+}
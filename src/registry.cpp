@@ -0,0 +1,88 @@
+#include "registry.h"
+#include "operators.h"
+#include <algorithm>
+
+namespace {
+// Amount of calls removed by destroy operators, [min_removal, min_removal + removal_ratio of calls]
+auto removalCount(const OperatorContext& c) {
+    const auto minimum = static_cast<unsigned int>(c.param("min_removal"));
+    const auto range = std::max(1u, static_cast<unsigned int>(c.param("removal_ratio") * c.p.calls.size()));
+    return [&ran = c.ran, minimum, range](){
+        return minimum + static_cast<unsigned int>(randomIndex(ran, range));
+    };
+}
+
+auto regretK(const OperatorContext& c) {
+    return static_cast<unsigned int>(c.param("k"));
+}
+
+const OperatorParams RUIN_PARAMS{{"min_removal", 2.0}, {"removal_ratio", 0.15}};
+
+OperatorParams ruinParams(double k) {
+    auto params = RUIN_PARAMS;
+    params.emplace("k", k);
+    return params;
+}
+}
+
+const std::vector<OperatorInfo>& operatorRegistry() {
+    static const std::vector<OperatorInfo> registry{
+        {"ex2", "Swaps two random calls", true, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&ran = c.ran](auto s){ return op::ex2(s, ran); };
+        }},
+        {"freorder", "Reorders a vehicle by time windows", true, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran](auto s){ return op::freorder(p, s, ran); };
+        }},
+        {"fesins", "Inserts a call into the vehicle with the largest capacity", false, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran](auto s){ return op::fesins(p, s, ran); };
+        }},
+        {"ins1", "Moves a random call to a random vehicle", true, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&ran = c.ran](auto s){ return op::ins1(s, ran); };
+        }},
+        {"priceinsert", "Inserts a call from the dummy into the cheapest vehicle", true, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran](auto s){ return op::priceinsert(p, s, ran); };
+        }},
+        {"validins", "Inserts a call into a random vehicle that can take it", true, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran](auto s){ return op::validins(p, s, ran); };
+        }},
+        {"regret", "Regret-k insertion of the dummy", true, {{"k", 2.0}}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, pool = c.pool, k = regretK(c)](auto s){ return op::regretinsert(p, s, k, pool); };
+        }},
+        // Ruin and recreate:
+        {"random_ruin", "Random removal followed by regret insertion", true, ruinParams(2.0), [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran, pool = c.pool, k = regretK(c), count = removalCount(c)](auto s){
+                return op::regretinsert(p, op::randomremoval(p, s, count(), ran), k, pool);
+            };
+        }},
+        {"worst_ruin", "Worst removal followed by regret insertion", true, ruinParams(1.0), [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran, pool = c.pool, k = regretK(c), count = removalCount(c)](auto s){
+                return op::regretinsert(p, op::worstremoval(p, s, count(), ran), k, pool);
+            };
+        }},
+        {"shaw_ruin", "Shaw removal followed by regret insertion", true, ruinParams(2.0), [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran, pool = c.pool, k = regretK(c), count = removalCount(c)](auto s){
+                return op::regretinsert(p, op::shawremoval(p, s, count(), ran), k, pool);
+            };
+        }},
+        // Intra-route:
+        {"relocate", "Best relocation of a call within a vehicle", true, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran](auto s){ return op::relocate(p, s, ran); };
+        }},
+        {"oropt", "Best move of up to three stops within a vehicle", true, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran](auto s){ return op::oropt(p, s, ran); };
+        }},
+        {"resequence", "Optimal order of the calls in a vehicle", true, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&p = c.p, &ran = c.ran](auto s){ return op::resequence(p, s, ran); };
+        }},
+        {"shuffle", "Shuffles a random vehicle", false, {}, [](const OperatorContext& c) -> OperatorSignature {
+            return [&ran = c.ran](auto s){ return op::shuffle(s, ran); };
+        }},
+    };
+    return registry;
+}
+
+const OperatorInfo* findOperator(std::string_view name) {
+    const auto& registry = operatorRegistry();
+    const auto it = std::find_if(registry.begin(), registry.end(), [name](const auto& info){ return info.name == name; });
+    return it != registry.end() ? &*it : nullptr;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "problem.h"
+#include <functional>
+#include <map>
+#include "random.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+/// Named numeric parameters of an operator
+using OperatorParams = std::map<std::string, double, std::less<>>;
+
+/// Operator as used by the adaptive search, bound to its problem and random engine
+using OperatorSignature = std::function<SolutionCached(SolutionCached)>;
+
+/// What an operator may bind to when it is built for a search
+struct OperatorContext {
+    const Problem& p;
+    Random& ran;
+    ThreadPool* pool;
+    const OperatorParams& params;
+
+    double param(std::string_view name) const { return params.find(name)->second; }
+};
+
+/**
+ * @brief Operator registered by name
+ * Every parameter the operator reads has to be listed in params, which
+ * also holds its default value. Parameters are read once when the
+ * operator is built, so changing them never costs anything per iteration.
+ */
+struct OperatorInfo {
+    std::string_view name;
+    std::string_view description;
+    bool bEnabled;          // Enabled by default
+    OperatorParams params;
+    OperatorSignature (*make)(const OperatorContext&);
+};
+
+/// Every operator the adaptive search can use, in default order
+const std::vector<OperatorInfo>& operatorRegistry();
+
+/// Registered operator with the given name, or nullptr
+const OperatorInfo* findOperator(std::string_view name);
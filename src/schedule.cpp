@@ -0,0 +1,277 @@
+#include "schedule.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <unordered_map>
+
+Segment depotSegment(const Problem& p, index_t vehicle) {
+    const auto& v{p.vehicles[vehicle]};
+    return Segment{
+        .first = v.homeNodeIndex,
+        .last = v.homeNodeIndex,
+        .duration = 0,
+        .timeWarp = 0,
+        .earliest = v.startingTime,
+        .latest = v.startingTime,
+        .cost = 0,
+        .load = 0,
+        .maxLoad = 0
+    };
+}
+
+Segment pickupSegment(const Problem& p, index_t vehicle, index_t call) {
+    const auto& c{p.calls[call]};
+    const auto& vc{p.vehicleCall(vehicle, call)};
+    return Segment{
+        .first = c.origin,
+        .last = c.origin,
+        .duration = vc.originNodeTime,
+        .timeWarp = 0,
+        .earliest = c.lowerTimewindowPickup,
+        .latest = c.upperTimewindowPickup,
+        .cost = vc.originNodeCosts,
+        .load = c.size,
+        .maxLoad = c.size
+    };
+}
+
+Segment deliverySegment(const Problem& p, index_t vehicle, index_t call) {
+    const auto& c{p.calls[call]};
+    const auto& vc{p.vehicleCall(vehicle, call)};
+    return Segment{
+        .first = c.destination,
+        .last = c.destination,
+        .duration = vc.destNodeTime,
+        .timeWarp = 0,
+        .earliest = c.lowerTimewindowDelivery,
+        .latest = c.upperTimewindowDelivery,
+        .cost = vc.destNodeCosts,
+        .load = -c.size,
+        .maxLoad = -c.size
+    };
+}
+
+Segment concat(const Problem& p, index_t vehicle, const Segment& a, const Segment& b) {
+    const auto travelTime = p.travelTime(vehicle, a.last, b.first);
+    // Time from starting service at a.first to arriving at b.first
+    const auto delta = a.duration - a.timeWarp + travelTime;
+    const auto deltaWaiting = std::max(b.earliest - delta - a.latest, 0);
+    const auto deltaTimeWarp = std::max(a.earliest + delta - b.latest, 0);
+
+    return Segment{
+        .first = a.first,
+        .last = b.last,
+        .duration = a.duration + b.duration + travelTime + deltaWaiting,
+        .timeWarp = a.timeWarp + b.timeWarp + deltaTimeWarp,
+        .earliest = std::max(b.earliest - delta, a.earliest) - deltaWaiting,
+        .latest = std::min(b.latest - delta, a.latest) + deltaTimeWarp,
+        .cost = a.cost + b.cost + p.travelCost(vehicle, a.last, b.first),
+        .load = a.load + b.load,
+        .maxLoad = std::max(a.maxLoad, a.load + b.maxLoad)
+    };
+}
+
+void buildSchedule(const Problem& p, index_t vehicle, const Route& route, RouteSchedule& out) {
+    const auto n = route.size();
+    out.vehicle = vehicle;
+    out.stops.resize(n);
+    out.prefix.resize(n + 1);
+    out.suffix.resize(n + 1);
+
+    for (std::size_t k{0}; k < n; ++k) {
+        const auto call = route[k];
+        const bool bPickup = std::find(route.begin(), route.begin() + k, call) == route.begin() + k;
+        out.stops[k] = bPickup ? pickupSegment(p, vehicle, call) : deliverySegment(p, vehicle, call);
+    }
+
+    out.prefix[0] = depotSegment(p, vehicle);
+    for (std::size_t k{0}; k < n; ++k)
+        out.prefix[k + 1] = concat(p, vehicle, out.prefix[k], out.stops[k]);
+
+    if (0 < n) {
+        out.suffix[n - 1] = out.stops[n - 1];
+        for (auto k{n - 1}; 0 < k; --k)
+            out.suffix[k - 1] = concat(p, vehicle, out.stops[k - 1], out.suffix[k]);
+    }
+}
+
+std::optional<Insertion> bestInsertion(const Problem& p, const RouteSchedule& schedule, index_t call) {
+    const auto v = schedule.vehicle;
+    if (!p.canTake(v, call))
+        return std::nullopt;
+
+    const auto n = schedule.size();
+    const auto baseCost = schedule.route().cost;
+    const auto pickup = pickupSegment(p, v, call);
+    const auto delivery = deliverySegment(p, v, call);
+
+    std::optional<Insertion> best{std::nullopt};
+    for (std::size_t i{0}; i <= n; ++i) {
+        // Everything up to and including the pickup
+        auto head = concat(p, v, schedule.prefix[i], pickup);
+        if (!feasible(p, v, head))
+            continue;
+
+        for (auto j{i}; j <= n; ++j) {
+            const auto withDelivery = concat(p, v, head, delivery);
+            const auto full = j < n ? concat(p, v, withDelivery, schedule.suffix[j]) : withDelivery;
+            if (feasible(p, v, full) && (!best || full.cost - baseCost < best->delta))
+                best = Insertion{v, call, static_cast<uint32_t>(i), static_cast<uint32_t>(j), full.cost - baseCost};
+
+            if (j == n)
+                break;
+            // Carry the call past the next stop. Time warp and load only grow,
+            // so once carrying it is infeasible, delivering later is too.
+            head = concat(p, v, head, schedule.stops[j]);
+            if (!feasible(p, v, head))
+                break;
+        }
+    }
+    return best;
+}
+
+std::optional<Insertion> bestInsertion(const Problem& p, const std::vector<RouteSchedule>& schedules, index_t call, ThreadPool* pool) {
+    // One slot per vehicle, reduced in vehicle order afterwards
+    std::vector<std::optional<Insertion>> results(schedules.size());
+    const auto evaluate = [&](std::size_t i){ results[i] = bestInsertion(p, schedules[i], call); };
+    if (pool)
+        pool->parallelFor(schedules.size(), evaluate);
+    else
+        for (std::size_t i{0}; i < schedules.size(); ++i)
+            evaluate(i);
+
+    std::optional<Insertion> best{std::nullopt};
+    for (const auto& r : results)
+        if (r && (!best || r->delta < best->delta))
+            best = r;
+    return best;
+}
+
+void applyInsertion(Route& route, const Insertion& ins) {
+    // Insert delivery first so the pickup index stays valid
+    route.insert(route.begin() + ins.delivery, ins.call);
+    route.insert(route.begin() + ins.pickup, ins.call);
+}
+
+Segment removalSegment(const Problem& p, const RouteSchedule& schedule, std::size_t pickup, std::size_t delivery) {
+    const auto v = schedule.vehicle;
+    auto seg = schedule.prefix[pickup];
+    for (auto k{pickup + 1}; k < delivery; ++k)
+        seg = concat(p, v, seg, schedule.stops[k]);
+    if (delivery + 1 < schedule.size())
+        seg = concat(p, v, seg, schedule.suffix[delivery + 1]);
+    return seg;
+}
+
+std::optional<Route> optimalRoute(const Problem& p, index_t vehicle, const Route& route, int upperBound) {
+    SmallVector<index_t, MAX_RESEQUENCE_CALLS> calls;
+    for (const auto call : route) {
+        if (std::find(calls.begin(), calls.end(), call) != calls.end())
+            continue;
+        if (calls.size() == MAX_RESEQUENCE_CALLS || !p.canTake(vehicle, call))
+            return std::nullopt;
+        calls.push_back(call);
+    }
+    const auto m = calls.size();
+    if (m == 0)
+        return std::nullopt;
+
+    const auto& v{p.vehicles[vehicle]};
+    // Stop 2i is the pickup of calls[i] and 2i + 1 its delivery
+    constexpr uint8_t NO_STOP = 0xFF;
+    const auto stopSegment = [&](uint8_t stop) {
+        return stop % 2 == 0 ? pickupSegment(p, vehicle, calls[stop / 2]) : deliverySegment(p, vehicle, calls[stop / 2]);
+    };
+    SmallVector<Segment, 2 * MAX_RESEQUENCE_CALLS> stops;
+    int totalHandling{0};
+    for (uint8_t stop{0}; stop < 2 * m; ++stop) {
+        stops.push_back(stopSegment(stop));
+        totalHandling += stops.back().cost;
+    }
+
+    struct Label {
+        uint32_t picked;
+        uint32_t delivered;
+        uint8_t last;
+        bool bDominated;
+        int time;     // Departure from last stop
+        int cost;
+        int load;
+        int handled;  // Handling costs paid so far
+        uint32_t parent;
+    };
+
+    // Labels by amount of visited stops
+    std::vector<std::vector<Label>> layers(2 * m + 1);
+    layers[0].push_back(Label{0, 0, NO_STOP, false, v.startingTime, 0, 0, 0, 0});
+    // Non-dominated labels of the layer being built, by state
+    std::unordered_map<uint64_t, SmallVector<uint32_t, 4>> front;
+
+    for (std::size_t k{0}; k < 2 * m; ++k) {
+        front.clear();
+        auto& next = layers[k + 1];
+        for (uint32_t li{0}; li < layers[k].size(); ++li) {
+            const auto label = layers[k][li];
+            if (label.bDominated)
+                continue;
+            const auto fromNode = label.last == NO_STOP ? v.homeNodeIndex : stops[label.last].last;
+
+            for (uint8_t i{0}; i < m; ++i) {
+                const uint32_t bit = 1u << i;
+                if (label.delivered & bit)
+                    continue;
+                const bool bPickup = !(label.picked & bit);
+                const uint8_t stop = 2 * i + (bPickup ? 0 : 1);
+                const auto& seg = stops[stop];
+
+                const auto load = label.load + seg.load;
+                if (v.capacity < load)
+                    continue;
+                const auto arrival = label.time + p.travelTime(vehicle, fromNode, seg.first);
+                if (seg.latest < arrival)
+                    continue;
+
+                Label l{
+                    bPickup ? label.picked | bit : label.picked,
+                    bPickup ? label.delivered : label.delivered | bit,
+                    stop,
+                    false,
+                    std::max(arrival, seg.earliest) + seg.duration,
+                    label.cost + p.travelCost(vehicle, fromNode, seg.first) + seg.cost,
+                    load,
+                    label.handled + seg.cost,
+                    li
+                };
+                // Travel costs are never negative, so the handling left is a lower bound
+                if (upperBound <= l.cost + totalHandling - l.handled)
+                    continue;
+
+                auto& candidates = front[l.picked | static_cast<uint64_t>(l.delivered) << 16 | static_cast<uint64_t>(stop) << 32];
+                if (std::any_of(candidates.begin(), candidates.end(), [&](const auto c){
+                    return next[c].cost <= l.cost && next[c].time <= l.time;
+                }))
+                    continue;
+                for (const auto c : candidates)
+                    if (l.cost <= next[c].cost && l.time <= next[c].time)
+                        next[c].bDominated = true;
+                erase_if(candidates, [&](const auto c){ return next[c].bDominated; });
+                candidates.push_back(static_cast<uint32_t>(next.size()));
+                next.push_back(l);
+            }
+        }
+    }
+
+    const auto& last = layers[2 * m];
+    const auto best = std::min_element(last.begin(), last.end(), [](const auto& a, const auto& b){ return a.cost < b.cost; });
+    if (best == last.end() || upperBound <= best->cost)
+        return std::nullopt;
+
+    Route out;
+    out.resize(2 * m);
+    auto index = static_cast<uint32_t>(best - last.begin());
+    for (auto k{2 * m}; 0 < k; --k) {
+        const auto& l = layers[k][index];
+        out[k - 1] = calls[l.last / 2];
+        index = l.parent;
+    }
+    return out;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "problem.h"
+#include <vector>
+#include <optional>
+#include <limits>
+
+class ThreadPool;
+
+/**
+ * @brief Summary of a sequence of stops driven by one vehicle
+ * Segments can be concatenated in constant time, which makes it possible
+ * to evaluate the cost and feasibility of a modified route without walking
+ * the whole route again. Time windows are handled with the segment
+ * concatenation from Vidal et al. (2013), "A hybrid genetic algorithm with
+ * adaptive diversity management for a large class of vehicle routing problems
+ * with time-windows", where any time warp means the sequence is infeasible.
+ */
+struct Segment {
+    index_t first;  // First node in segment
+    index_t last;   // Last node in segment
+    int duration;   // Minimum time spent driving, serving and waiting
+    int timeWarp;   // How much too late the sequence is. Anything above 0 is infeasible.
+    int earliest;   // Earliest time service can start at the first node
+    int latest;     // Latest time service can start at the first node without adding time warp
+    int cost;       // Travel costs + pickup/delivery costs
+    int load;       // Load change over the whole segment
+    int maxLoad;    // Highest load seen at any stop, relative to the start of the segment
+};
+
+// Vehicle leaving its home node at starting time
+Segment depotSegment(const Problem& p, index_t vehicle);
+Segment pickupSegment(const Problem& p, index_t vehicle, index_t call);
+Segment deliverySegment(const Problem& p, index_t vehicle, index_t call);
+
+/// Segment visiting all of a and then all of b
+Segment concat(const Problem& p, index_t vehicle, const Segment& a, const Segment& b);
+
+inline bool feasible(const Problem& p, index_t vehicle, const Segment& s) {
+    return s.timeWarp == 0 && s.maxLoad <= p.vehicles[vehicle].capacity;
+}
+
+/**
+ * @brief Cached schedule of a single vehicle route
+ * Holds the segment of every stop together with every prefix and suffix,
+ * so any move that cuts the route into a constant number of pieces can be
+ * evaluated in constant time.
+ */
+struct RouteSchedule {
+    index_t vehicle;
+    std::vector<Segment> stops;  // stops[k] = stop k
+    std::vector<Segment> prefix; // prefix[k] = depot + stops [0, k)
+    std::vector<Segment> suffix; // suffix[k] = stops [k, n), suffix[n] is unused
+
+    std::size_t size() const { return stops.size(); }
+    const Segment& route() const { return prefix.back(); }
+};
+
+/**
+ * @brief Builds the schedule for a route into out
+ * Reuses the buffers of out, so rebuilding a schedule doesn't allocate.
+ * The first occurrence of a call is the pickup, the second the delivery.
+ */
+void buildSchedule(const Problem& p, index_t vehicle, const Route& route, RouteSchedule& out);
+
+/**
+ * @brief Insertion of a call into a route
+ * The pickup is placed before original stop pickup and the delivery before
+ * original stop delivery (pickup <= delivery), so the new route becomes
+ * route[0, pickup) + P + route[pickup, delivery) + D + route[delivery, n)
+ */
+struct Insertion {
+    index_t vehicle;
+    index_t call;
+    uint32_t pickup;
+    uint32_t delivery;
+    int delta; // Cost difference of the vehicle route
+};
+
+/// Cheapest feasible insertion of call into the scheduled route, if any
+std::optional<Insertion> bestInsertion(const Problem& p, const RouteSchedule& schedule, index_t call);
+
+/**
+ * @brief Cheapest feasible insertion of call into any of the scheduled vehicles
+ * With a pool the vehicles are evaluated in parallel. Ties go to the lowest
+ * vehicle index, so the result is the same with or without threading.
+ */
+std::optional<Insertion> bestInsertion(const Problem& p, const std::vector<RouteSchedule>& schedules, index_t call, ThreadPool* pool = nullptr);
+
+/// Applies an insertion to a route
+void applyInsertion(Route& route, const Insertion& ins);
+
+/// Route segment (including depot) with the stops at pickup and delivery taken out
+Segment removalSegment(const Problem& p, const RouteSchedule& schedule, std::size_t pickup, std::size_t delivery);
+
+/// Largest amount of calls optimalRoute will sequence
+constexpr std::size_t MAX_RESEQUENCE_CALLS = 10;
+
+/**
+ * @brief Finds the cheapest feasible order of the calls in a route
+ * Exact dynamic program over (picked up calls, delivered calls, last stop),
+ * keeping only labels not dominated in both cost and time, and pruning on
+ * time windows, capacity and a lower bound of the remaining handling costs.
+ * @param upperBound Only routes cheaper than this are returned
+ * @return Cheapest route cheaper than upperBound, or nothing if there are none
+ * or the route has more than MAX_RESEQUENCE_CALLS calls.
+ */
+std::optional<Route> optimalRoute(const Problem& p, index_t vehicle, const Route& route, int upperBound = std::numeric_limits<int>::max());
@@ -0,0 +1,21 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Seed of an independent random stream derived from a master seed
+ * Mixes the master seed with the ids identifying the stream (instance, run,
+ * candidate...) through std::seed_seq, so every stream only depends on the
+ * master seed and its own ids, never on which thread it ends up running on.
+ */
+inline std::uint64_t streamSeed(unsigned int seed, std::initializer_list<std::uint32_t> ids) {
+    std::vector<std::uint32_t> data{seed};
+    data.insert(data.end(), ids.begin(), ids.end());
+    std::seed_seq seq(data.begin(), data.end());
+    std::array<std::uint32_t, 2> out;
+    seq.generate(out.begin(), out.end());
+    return static_cast<std::uint64_t>(out[0]) << 32 | out[1];
+}
@@ -0,0 +1,244 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+/**
+ * @brief Vector with inline storage for the first N elements.
+ * Only spills over to the heap when it grows past N elements, so
+ * copying and iterating short containers never touches the allocator.
+ * Restricted to trivially copyable types so elements can be moved around
+ * with plain memory copies.
+ * @tparam T Element type
+ * @tparam N Inline capacity
+ */
+template <typename T, std::size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector only supports trivially copyable types");
+    static_assert(0 < N, "SmallVector needs an inline capacity of at least 1");
+
+    T* data_;
+    uint32_t size_{0};
+    uint32_t capacity_{N};
+    T inline_[N];
+
+    bool onHeap() const noexcept { return data_ != inline_; }
+
+    // Moves content into a buffer of at least the given capacity
+    void grow(std::size_t minCapacity) {
+        auto newCapacity = std::max<std::size_t>(minCapacity, 2 * static_cast<std::size_t>(capacity_));
+        T* buffer = new T[newCapacity];
+        std::memcpy(buffer, data_, size_ * sizeof(T));
+        if (onHeap())
+            delete[] data_;
+        data_ = buffer;
+        capacity_ = static_cast<uint32_t>(newCapacity);
+    }
+
+    // Opens up a gap of count elements at index and returns a pointer to it
+    T* openGap(std::size_t index, std::size_t count) {
+        if (capacity_ < size_ + count)
+            grow(size_ + count);
+        T* pos = data_ + index;
+        std::memmove(pos + count, pos, (size_ - index) * sizeof(T));
+        size_ += static_cast<uint32_t>(count);
+        return pos;
+    }
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() noexcept : data_{inline_} {}
+
+    SmallVector(std::initializer_list<T> list) : SmallVector(list.begin(), list.end()) {}
+
+    template <std::input_iterator It>
+    SmallVector(It first, It last) : data_{inline_} {
+        if constexpr (std::forward_iterator<It>)
+            reserve(static_cast<std::size_t>(std::distance(first, last)));
+        for (; first != last; ++first)
+            push_back(static_cast<T>(*first));
+    }
+
+    SmallVector(const SmallVector& rhs) : data_{inline_} {
+        reserve(rhs.size_);
+        std::memcpy(data_, rhs.data_, rhs.size_ * sizeof(T));
+        size_ = rhs.size_;
+    }
+
+    SmallVector(SmallVector&& rhs) noexcept : data_{inline_} {
+        if (rhs.onHeap()) {
+            data_ = rhs.data_;
+            capacity_ = rhs.capacity_;
+            rhs.data_ = rhs.inline_;
+            rhs.capacity_ = N;
+        } else
+            std::memcpy(data_, rhs.data_, rhs.size_ * sizeof(T));
+        size_ = rhs.size_;
+        rhs.size_ = 0;
+    }
+
+    // Reuses the existing buffer when it is big enough, so repeated
+    // assignments between solutions don't reallocate either.
+    SmallVector& operator=(const SmallVector& rhs) {
+        if (this == &rhs)
+            return *this;
+        size_ = 0;
+        reserve(rhs.size_);
+        std::memcpy(data_, rhs.data_, rhs.size_ * sizeof(T));
+        size_ = rhs.size_;
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& rhs) noexcept {
+        if (this == &rhs)
+            return *this;
+        if (rhs.onHeap()) {
+            if (onHeap())
+                delete[] data_;
+            data_ = rhs.data_;
+            capacity_ = rhs.capacity_;
+            rhs.data_ = rhs.inline_;
+            rhs.capacity_ = N;
+        } else
+            std::memcpy(data_, rhs.data_, rhs.size_ * sizeof(T));
+        size_ = rhs.size_;
+        rhs.size_ = 0;
+        return *this;
+    }
+
+    ~SmallVector() {
+        if (onHeap())
+            delete[] data_;
+    }
+
+    size_type size() const noexcept { return size_; }
+    size_type capacity() const noexcept { return capacity_; }
+    bool empty() const noexcept { return size_ == 0; }
+    static constexpr size_type inline_capacity() noexcept { return N; }
+
+    T* data() noexcept { return data_; }
+    const T* data() const noexcept { return data_; }
+
+    iterator begin() noexcept { return data_; }
+    const_iterator begin() const noexcept { return data_; }
+    iterator end() noexcept { return data_ + size_; }
+    const_iterator end() const noexcept { return data_ + size_; }
+
+    T& operator[](size_type i) noexcept { return data_[i]; }
+    const T& operator[](size_type i) const noexcept { return data_[i]; }
+
+    T& at(size_type i) {
+        if (size_ <= i)
+            throw std::out_of_range{"SmallVector index out of range"};
+        return data_[i];
+    }
+    const T& at(size_type i) const {
+        if (size_ <= i)
+            throw std::out_of_range{"SmallVector index out of range"};
+        return data_[i];
+    }
+
+    T& front() noexcept { return data_[0]; }
+    const T& front() const noexcept { return data_[0]; }
+    T& back() noexcept { return data_[size_ - 1]; }
+    const T& back() const noexcept { return data_[size_ - 1]; }
+
+    void reserve(size_type n) {
+        if (capacity_ < n)
+            grow(n);
+    }
+
+    void clear() noexcept { size_ = 0; }
+
+    void resize(size_type n, const T& value = T{}) {
+        reserve(n);
+        for (auto i{size_}; i < n; ++i)
+            data_[i] = value;
+        size_ = static_cast<uint32_t>(n);
+    }
+
+    void push_back(const T& value) {
+        // Copy first in case value lives inside this container
+        const T v{value};
+        if (capacity_ == size_)
+            grow(size_ + 1);
+        data_[size_++] = v;
+    }
+
+    void pop_back() noexcept { --size_; }
+
+    iterator insert(const_iterator pos, const T& value) {
+        const T v{value};
+        T* gap = openGap(static_cast<std::size_t>(pos - data_), 1);
+        *gap = v;
+        return gap;
+    }
+
+    template <std::forward_iterator It>
+    iterator insert(const_iterator pos, It first, It last) {
+        const auto index = static_cast<std::size_t>(pos - data_);
+        const auto count = static_cast<std::size_t>(std::distance(first, last));
+        if (count == 0)
+            return data_ + index;
+
+        // Inserting a range from ourself would be invalidated by the gap, so copy it out first.
+        if constexpr (std::is_pointer_v<It>) {
+            if (data_ <= &*first && &*first < data_ + size_) {
+                const SmallVector tmp{first, last};
+                return insert(pos, tmp.begin(), tmp.end());
+            }
+        }
+
+        T* gap = openGap(index, count);
+        std::copy(first, last, gap);
+        return gap;
+    }
+
+    iterator erase(const_iterator pos) noexcept {
+        return erase(pos, pos + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) noexcept {
+        T* f = data_ + (first - data_);
+        const auto count = static_cast<std::size_t>(last - first);
+        std::memmove(f, f + count, (end() - (f + count)) * sizeof(T));
+        size_ -= static_cast<uint32_t>(count);
+        return f;
+    }
+
+    friend bool operator==(const SmallVector& lhs, const SmallVector& rhs) noexcept {
+        return lhs.size_ == rhs.size_ && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+};
+
+/// Equivalent of std::erase for SmallVector. Returns the number of removed elements.
+template <typename T, std::size_t N, typename U>
+std::size_t erase(SmallVector<T, N>& c, const U& value) {
+    const auto it = std::remove(c.begin(), c.end(), value);
+    const auto count = static_cast<std::size_t>(c.end() - it);
+    c.erase(it, c.end());
+    return count;
+}
+
+/// Equivalent of std::erase_if for SmallVector. Returns the number of removed elements.
+template <typename T, std::size_t N, typename Pred>
+std::size_t erase_if(SmallVector<T, N>& c, Pred pred) {
+    const auto it = std::remove_if(c.begin(), c.end(), pred);
+    const auto count = static_cast<std::size_t>(c.end() - it);
+    c.erase(it, c.end());
+    return count;
+}
@@ -0,0 +1,9 @@
+#include "solver.h"
+
+Solver::Solver(SearchConfig config, unsigned int threadCount, unsigned int seed)
+    : searchConfig{std::move(config)}, ran{seed}, threads{threadCount} {
+}
+
+SolutionCached Solver::solve(const Problem& p, TimeBudget::Run* budget, const Checkpoint* checkpoint, const ImprovementObserver* observer, StopReason* stopReason) {
+    return adaptiveCachedSearch(p, ran, budget, 0 < threads.size() ? &threads : nullptr, &searchConfig, nullptr, checkpoint, observer, &scratch, stopReason);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "problem.h"
+#include "heuristics.h"
+#include "config.h"
+#include "threadpool.h"
+#include <random>
+#include "random.h"
+
+/**
+ * @brief Independent adaptive search solver
+ * Owns everything a search needs that outlives a single search: its settings,
+ * random engine, thread pool and working memory. Solvers share no state with
+ * each other, so any number of them can be used side by side in one process,
+ * each from its own thread.
+ */
+class Solver {
+public:
+    /**
+     * @param config Search settings
+     * @param threadCount Workers of the solver's thread pool, used for parallel
+     * neighborhood evaluation and speculative candidates. With 0 everything
+     * runs on the thread calling solve.
+     * @param seed Seed of the solver's random engine
+     */
+    explicit Solver(SearchConfig config = {}, unsigned int threadCount = 0, unsigned int seed = std::random_device{}());
+
+    Solver(const Solver&) = delete;
+    Solver& operator=(const Solver&) = delete;
+
+    /**
+     * @brief Searches for a good solution to p
+     * Consecutive calls continue the solver's random sequence, so they find
+     * different solutions. Not to be called from several threads at once.
+     * @see adaptiveCachedSearch for the optional arguments
+     */
+    SolutionCached solve(const Problem& p, TimeBudget::Run* budget = nullptr, const Checkpoint* checkpoint = nullptr, const ImprovementObserver* observer = nullptr, StopReason* stopReason = nullptr);
+
+    const SearchConfig& config() const { return searchConfig; }
+    Random& engine() { return ran; }
+    ThreadPool& pool() { return threads; }
+
+private:
+    SearchConfig searchConfig;
+    Random ran;
+    ThreadPool threads;
+    SearchScratch scratch;
+};
@@ -0,0 +1,67 @@
+#include "stream.h"
+#include <iomanip>
+#include <sstream>
+
+namespace {
+void writeJsonString(std::ostream& os, std::string_view str) {
+    os << '"';
+    for (const auto c : str) {
+        if (c == '"' || c == '\\')
+            os << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20)
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+        else
+            os << c;
+    }
+    os << '"';
+}
+}
+
+SolutionStream::SolutionStream(std::ostream& os, std::chrono::steady_clock::time_point start)
+    : os{os}, start{start}, writer{[this](){ write(); }} {
+}
+
+SolutionStream::~SolutionStream() {
+    pending.fetch_or(STOP, std::memory_order_release);
+    pending.notify_one();
+    writer.join();
+}
+
+void SolutionStream::publish(std::string_view instance, std::size_t run, int cost, const SolutionCached& s) {
+    queue.push(Improvement{std::string{instance}, run, cost, std::chrono::steady_clock::now() - start, fromNestedList(s)});
+    pending.fetch_add(1, std::memory_order_release);
+    pending.notify_one();
+}
+
+void SolutionStream::write() {
+    for (;;) {
+        const auto n = pending.load(std::memory_order_acquire);
+        if ((n & ~STOP) == 0) {
+            if (n & STOP)
+                return;
+            pending.wait(n, std::memory_order_acquire);
+            continue;
+        }
+
+        auto improvement = queue.pop();
+        if (!improvement) {
+            // Push still linking in its node
+            std::this_thread::yield();
+            continue;
+        }
+        pending.fetch_sub(1, std::memory_order_relaxed);
+
+        // Format the whole line first so it goes out in one write
+        std::ostringstream line;
+        line << "{\"instance\": ";
+        writeJsonString(line, improvement->instance);
+        line << ", \"run\": " << improvement->run
+             << ", \"cost\": " << improvement->cost
+             << ", \"time_ms\": " << std::fixed << std::setprecision(1) << std::chrono::duration<double, std::milli>(improvement->time).count()
+             << ", \"solution\": [";
+        for (std::size_t i{0}; i < improvement->solution.size(); ++i)
+            line << (i == 0 ? "" : ", ") << improvement->solution[i];
+        line << "]}\n";
+        os << line.str() << std::flush;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "problem.h"
+#include "mpscqueue.h"
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Streams new best solutions as JSON lines while the searches keep going
+ * Searches publish from their own threads into a lock-free queue, and a
+ * writer thread owned by the stream formats and writes them, so a slow
+ * reader on the other end never holds up a search. Every line looks like
+ * {"instance": "Call_7_Vehicle_3.txt", "run": 0, "cost": 1476444, "time_ms": 12.5, "solution": [3, 3, 0, ...]}
+ * where time_ms counts from start.
+ */
+class SolutionStream {
+public:
+    /// Writes to os, which has to outlive the stream
+    SolutionStream(std::ostream& os, std::chrono::steady_clock::time_point start);
+    /// Writes out everything published so far before returning
+    ~SolutionStream();
+
+    SolutionStream(const SolutionStream&) = delete;
+    SolutionStream& operator=(const SolutionStream&) = delete;
+
+    /// Queues a solution for writing. Any thread, never waits on the writer.
+    void publish(std::string_view instance, std::size_t run, int cost, const SolutionCached& s);
+
+private:
+    struct Improvement {
+        std::string instance;
+        std::size_t run{0};
+        int cost{0};
+        std::chrono::steady_clock::duration time{};
+        std::vector<int> solution;
+    };
+
+    static constexpr unsigned int STOP = 1u << 31;
+
+    void write();
+
+    std::ostream& os;
+    std::chrono::steady_clock::time_point start;
+    MpscQueue<Improvement> queue;
+    // Improvements in the queue, with STOP set once the stream is being destroyed
+    std::atomic<unsigned int> pending{0};
+    std::thread writer;
+};
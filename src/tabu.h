@@ -0,0 +1,90 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Tabu attributes, each with the iteration it stays tabu until
+ * Open addressing hash table with linear probing in one flat array, so a
+ * lookup is a multiplication and usually a single cache line. Slots of
+ * attributes whose tenure has run out are reused by later insertions, and
+ * the table is rebuilt without them whenever it fills up, which keeps it
+ * proportional to the tenure rather than to the number of possible attributes.
+ */
+class TabuList {
+public:
+    /// Room for about capacity attributes being tabu at once before growing
+    explicit TabuList(std::size_t capacity = 64) : slots(std::bit_ceil(std::max<std::size_t>(capacity * 2, 8))) {}
+
+    /// Whether attribute is tabu at iteration
+    bool tabu(std::uint32_t attribute, std::uint32_t iteration) const {
+        for (auto i = slot(attribute); slots[i].until != EMPTY; i = (i + 1) & mask())
+            if (slots[i].attribute == attribute)
+                return iteration < slots[i].until;
+        return false;
+    }
+
+    /// Makes attribute tabu from iteration and tenure iterations on (tenure > 0)
+    void add(std::uint32_t attribute, std::uint32_t iteration, std::uint32_t tenure) {
+        const auto until = iteration + tenure;
+        Entry* reuse{nullptr};
+        auto i = slot(attribute);
+        for (; slots[i].until != EMPTY; i = (i + 1) & mask()) {
+            if (slots[i].attribute == attribute) {
+                slots[i].until = until;
+                return;
+            }
+            if (reuse == nullptr && slots[i].until <= iteration)
+                reuse = &slots[i];
+        }
+        if (reuse != nullptr) {
+            *reuse = Entry{attribute, until};
+            return;
+        }
+        slots[i] = Entry{attribute, until};
+        // Keep at least a quarter of the slots empty, so probing always ends quickly
+        if (slots.size() * 3 / 4 < ++used)
+            rebuild(iteration);
+    }
+
+    void clear() {
+        slots.assign(slots.size(), Entry{});
+        used = 0;
+    }
+
+private:
+    struct Entry {
+        std::uint32_t attribute{0};
+        std::uint32_t until{EMPTY};
+    };
+    static constexpr std::uint32_t EMPTY = 0;   // No attribute is tabu until iteration 0
+
+    std::size_t mask() const { return slots.size() - 1; }
+    std::size_t slot(std::uint32_t attribute) const {
+        // Fibonacci hashing, taking the high bits of the product
+        return static_cast<std::size_t>((attribute * 0x9E3779B97F4A7C15ull) >> (64 - std::countr_zero(slots.size()))) & mask();
+    }
+
+    void rebuild(std::uint32_t iteration) {
+        std::vector<Entry> active;
+        for (const auto& e : slots)
+            if (e.until != EMPTY && iteration < e.until)
+                active.push_back(e);
+        // Grow if the attributes still tabu would fill more than half
+        auto size = slots.size();
+        while (size / 2 < active.size())
+            size *= 2;
+        slots.assign(size, Entry{});
+        used = active.size();
+        for (const auto& e : active) {
+            auto i = slot(e.attribute);
+            while (slots[i].until != EMPTY)
+                i = (i + 1) & mask();
+            slots[i] = e;
+        }
+    }
+
+    std::vector<Entry> slots;
+    std::size_t used{0};    // Slots that aren't EMPTY, including the ones that have run out
+};
@@ -0,0 +1,89 @@
+#include "threadpool.h"
+
+namespace {
+// Pool and queue of the worker running on this thread, if any
+thread_local const ThreadPool* currentPool{nullptr};
+thread_local std::size_t currentQueue{0};
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    queues.reserve(threadCount);
+    for (unsigned int i{0}; i < threadCount; ++i)
+        queues.push_back(std::make_unique<Queue>());
+    workers.reserve(threadCount);
+    for (unsigned int i{0}; i < threadCount; ++i)
+        workers.emplace_back([this, i](){ workerLoop(i); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock{sleepMutex};
+        bStop = true;
+    }
+    cv.notify_all();
+    for (auto& t : workers)
+        t.join();
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    const bool bWorker = currentPool == this;
+    if (!bWorker && queues.empty()) {
+        // No workers to run it
+        task();
+        return;
+    }
+
+    auto& q = *queues[bWorker ? currentQueue : nextQueue++ % queues.size()];
+    {
+        std::lock_guard lock{q.m};
+        if (bWorker)
+            q.tasks.push_front(std::move(task));
+        else
+            q.tasks.push_back(std::move(task));
+    }
+    ++pending;
+    {
+        // Taking the lock makes sure a worker about to sleep sees the new task
+        std::lock_guard lock{sleepMutex};
+    }
+    cv.notify_one();
+}
+
+bool ThreadPool::tryRun(std::size_t self) {
+    std::function<void()> task;
+    // Own queue from the front, then steal from the back of the others
+    for (std::size_t k{0}; k < queues.size() && !task; ++k) {
+        auto& q = *queues[(self + k) % queues.size()];
+        std::lock_guard lock{q.m};
+        if (q.tasks.empty())
+            continue;
+        if (k == 0) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        } else {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        }
+    }
+    if (!task)
+        return false;
+    --pending;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(std::size_t self) {
+    currentPool = this;
+    currentQueue = self;
+    for (;;) {
+        if (tryRun(self))
+            continue;
+
+        std::unique_lock lock{sleepMutex};
+        if (bStop && pending.load() == 0)
+            return;
+        ++idle;
+        cv.wait(lock, [this](){ return bStop || 0 < pending.load(); });
+        --idle;
+    }
+}
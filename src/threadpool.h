@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Fixed size work-stealing pool of worker threads
+ * Meant to be created once and shared by every search, so that
+ * parallel evaluation doesn't pay for thread creation on every use.
+ * Every worker has its own queue. Tasks submitted from a worker go to
+ * the front of its own queue and are picked up by the same worker first
+ * (keeping its data hot), while idle workers steal from the back of the
+ * other queues. Tasks submitted from outside are spread over the queues.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return workers.size(); }
+    /// Workers currently waiting for work
+    std::size_t idleCount() const { return idle.load(std::memory_order_relaxed); }
+
+    template <typename F>
+    auto submit(F&& f) -> std::future<std::invoke_result_t<F>> {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        auto future = task->get_future();
+        enqueue([task](){ (*task)(); });
+        return future;
+    }
+
+    /**
+     * @brief Runs f(i) for every i in [0, count) and waits for all of them.
+     * The calling thread takes part in the work and only idle workers are
+     * asked to help, so calling this from inside a task (or while every
+     * worker is busy) can't deadlock or flood the queues.
+     * Which thread runs which index is not deterministic, so f should write
+     * its result to a slot indexed by i and leave the reduction to the caller.
+     */
+    template <typename F>
+    void parallelFor(std::size_t count, F&& f) {
+        if (count == 0)
+            return;
+        const auto helpers = std::min(idleCount(), count - 1);
+        if (helpers == 0) {
+            for (std::size_t i{0}; i < count; ++i)
+                f(i);
+            return;
+        }
+
+        // Shared so that helpers starting after everything is done don't touch the stack of this call
+        struct State {
+            std::atomic<std::size_t> next{0};
+            std::atomic<std::size_t> done{0};
+        };
+        auto state = std::make_shared<State>();
+        const auto work = [state, count, &f](){
+            for (auto i = state->next++; i < count; i = state->next++) {
+                f(i);
+                ++state->done;
+            }
+        };
+
+        for (std::size_t h{0}; h < helpers; ++h)
+            enqueue(work);
+        work();
+
+        // Every index has been claimed, wait for the ones still running elsewhere
+        while (state->done.load() < count)
+            std::this_thread::yield();
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void enqueue(std::function<void()> task);
+    bool tryRun(std::size_t self);
+    void workerLoop(std::size_t self);
+
+    std::vector<std::unique_ptr<Queue>> queues; // One per worker
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> pending{0};        // Tasks in any queue
+    std::atomic<std::size_t> idle{0};
+    std::atomic<std::size_t> nextQueue{0};      // Round robin for tasks from outside the pool
+    std::mutex sleepMutex;
+    std::condition_variable cv;
+    bool bStop{false};
+};